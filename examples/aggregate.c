@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Computes SUM, MIN and MAX of field with ldb_aggregate(),
+//range split in two parts is combined by ldb_aggregate_merge()
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+LighDB db;
+uint32_t dbbuf[512/4];
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    r = ldb_create(&db, "aggregate.ind", "aggregate.dat", sizeof(item_t), 0, 0);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+
+    for (uint32_t i = 0; i < 100; i++) {
+	item_t item = {i % 4, (int32_t)i - 50};
+	ldb_add(&db, &item, sizeof(item), item.sensor, 0);
+    }
+
+    int ok = 1;
+    LDB_AGG_RES sum, min, max;
+    r = ldb_aggregate(&db, 4, LDB_T_I32, LDB_AGG_SUM, 0, 100, &sum);
+    printf("sum result %d, count %d, sum %d\n", r, sum.count, (int)sum.v.i);
+    ok &= r == LDB_OK && sum.count == 100 && sum.v.i == -50;
+    r = ldb_aggregate(&db, 4, LDB_T_I32, LDB_AGG_MIN, 0, 100, &min);
+    printf("min result %d, min %d\n", r, (int)min.v.i);
+    ok &= r == LDB_OK && min.v.i == -50;
+    // "to" bigger than count is equal to count
+    r = ldb_aggregate(&db, 4, LDB_T_I32, LDB_AGG_MAX, 0, 1000, &max);
+    printf("max result %d, max %d\n", r, (int)max.v.i);
+    ok &= r == LDB_OK && max.count == 100 && max.v.i == 49;
+
+    // same sum by two parts
+    LDB_AGG_RES part;
+    ldb_aggregate(&db, 4, LDB_T_I32, LDB_AGG_SUM, 0, 30, &sum);
+    ldb_aggregate(&db, 4, LDB_T_I32, LDB_AGG_SUM, 30, 100, &part);
+    ldb_aggregate_merge(LDB_T_I32, LDB_AGG_SUM, &sum, &part);
+    printf("merged count %d, sum %d\n", sum.count, (int)sum.v.i);
+    ok &= sum.count == 100 && sum.v.i == -50;
+
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
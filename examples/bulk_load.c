@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Builds DB from reader with ldb_bulk_load(). Reader which fails midway
+//leaves closed empty DB
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+#define ITEMS_COUNT 1000
+
+LighDB db;
+uint32_t dbbuf[512/4];
+
+typedef struct {
+    uint32_t next;  //index of next item
+    uint32_t fail;  //index of item which can't be read, or ITEMS_COUNT
+} reader_t;
+
+uint8_t read_item(uint8_t *data, uint32_t *id, void *arg)
+{
+    reader_t *rd = (reader_t*)arg;
+    if(rd->next == ITEMS_COUNT)
+	return 0; //no more items
+    if(rd->next == rd->fail)
+	return 2; //f.e. sensor doesn't answer
+    item_t *item = (item_t*)data;
+    item->sensor = rd->next % 4;
+    item->value = rd->next;
+    *id = rd->next * 2;
+    rd->next ++;
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    int ok = 1;
+    reader_t rd = {0, ITEMS_COUNT};
+    r = ldb_bulk_load(&db, "bulk.ind", "bulk.dat", sizeof(item_t), 0, 0,
+		      dbbuf, sizeof(dbbuf), read_item, &rd);
+    printf("load result %d, count %d\n", r, db.h.count);
+    if(r != LDB_OK)
+	return 1;
+    ok &= db.h.count == ITEMS_COUNT;
+    for (uint32_t i = 0; i < ITEMS_COUNT; i += 37) {
+	item_t item;
+	r = ldb_get(&db, i * 2, (uint8_t*)&item, sizeof(item));
+	ok &= r == LDB_OK && item.value == (int32_t)i;
+    }
+    ldb_close(&db);
+
+    // reader fails after two batches
+    rd.next = 0;
+    rd.fail = 500;
+    r = ldb_bulk_load(&db, "bulk.ind", "bulk.dat", sizeof(item_t), 0, 0,
+		      dbbuf, sizeof(dbbuf), read_item, &rd);
+    printf("failed load result %d, opened %d\n", r, db.opened);
+    ok &= r == LDB_ERR && db.opened == 0;
+
+    // buffer can't fit ID table
+    rd.next = 0;
+    rd.fail = ITEMS_COUNT;
+    r = ldb_bulk_load(&db, "bulk.ind", "bulk.dat", sizeof(item_t), 0, 0,
+		      dbbuf, 4, read_item, &rd);
+    printf("small buffer load result %d, opened %d\n", r, db.opened);
+    ok &= r == LDB_ERR_SMALL_BUFFER && db.opened == 0;
+
+    // files of failed load keep empty DB
+    r = ldb_open(&db, "bulk.ind", "bulk.dat");
+    printf("open result %d, count %d\n", r, db.h.count);
+    ok &= r == LDB_OK && db.h.count == 0;
+    ldb_close(&db);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Checks items and ID table of DB with checksums by ldb_verify(),
+//then damages last item in data file and finds it.
+//Needs LDB_CRC 1 in lighdb_conf.h
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+LighDB db;
+uint32_t dbbuf[1024/4]; //must fit page of ID table, (LDB_CRC_PAGE_IDS + 1) * 4 bytes
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    r = ldb_create_ex(&db, "crc.ind", "crc.dat", sizeof(item_t), 0, 0, LDB_F_CRC);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    r = ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    printf("set buffer result %d\n", r);
+
+    // more than one page of ID table
+    for (uint32_t i = 0; i < 300; i++) {
+	item_t item = {i % 4, (int32_t)i};
+	ldb_add(&db, &item, sizeof(item), i, 0);
+    }
+
+    int ok = 1;
+    uint32_t bad = 0;
+    r = ldb_verify(&db, &bad);
+    printf("verify result %d\n", r);
+    ok &= r == LDB_OK;
+    ldb_close(&db);
+
+    // flip last byte of data file
+    FILE *f = fopen("crc.dat", "r+b");
+    if(!f)
+	return 1;
+    fseek(f, -1, SEEK_END);
+    int c = fgetc(f);
+    fseek(f, -1, SEEK_END);
+    fputc(c ^ 0xff, f);
+    fclose(f);
+
+    ldb_open(&db, "crc.ind", "crc.dat");
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    r = ldb_verify(&db, &bad);
+    printf("verify result %d, damaged item %d\n", r, bad);
+    ok &= r == LDB_ERR_CRC && bad == 299;
+
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#define _GNU_SOURCE //for O_DIRECT
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "lighdb.h"
+
+//Keeps DB with page aligned ID table, data and items and reads it with O_DIRECT
+//by lighdb_direct.c. Buffer aligned to page is read without copies.
+//Returns 77 (skipped) if file system doesn't support O_DIRECT
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+    uint8_t name[16];
+} item_t; //with CRC it takes 28 bytes, so rows are padded to 32
+
+#define ITEMS_COUNT 3000
+
+LighDB db;
+uint32_t dbbuf[16384/4] __attribute__((aligned(LDB_DIRECT_ALIGN)));
+
+static uint32_t scanned;
+uint8_t count_item(uint32_t index, uint8_t *data, uint32_t size, void *arg)
+{
+    item_t *item = (item_t*)data;
+    if(item->value == (int32_t)index)
+	scanned ++;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = open("direct.probe", O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if(fd < 0 && errno == EINVAL) {
+	printf("O_DIRECT isn't supported, skipped\n");
+	return 77;
+    }
+    if(fd >= 0)
+	close(fd);
+    unlink("direct.probe");
+
+    LDB_RES r;
+    int ok = 1;
+    uint32_t flags = LDB_F_ALIGNED | LDB_F_ALIGN_ROWS | LDB_F_CRC;
+    r = ldb_create_ex(&db, "aligned.ind", "aligned.dat", sizeof(item_t), 5, (uint8_t*)"v001", flags);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    for (uint32_t i = 0; i < ITEMS_COUNT; i++) {
+	item_t item = {i % 4, (int32_t)i, "sensor"};
+	ldb_add(&db, &item, sizeof(item), i, 0);
+    }
+    ldb_close(&db);
+
+    r = ldb_open(&db, "aligned.ind", "aligned.dat");
+    printf("open result %d, count %d, flags %x\n", r, db.h.count, db.h.flags);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    ok &= db.h.count == ITEMS_COUNT && (db.h.flags & flags) == flags;
+    printf("ID table offset %d, data offset %d\n", db.index_offset, db.data_offset);
+    ok &= db.index_offset % LDB_ALIGN == 0 && db.data_offset % LDB_ALIGN == 0;
+
+    for (uint32_t i = 0; i < ITEMS_COUNT; i += 13) {
+	item_t item;
+	r = ldb_get(&db, i, (uint8_t*)&item, sizeof(item));
+	if(r != LDB_OK || item.value != (int32_t)i) {
+	    printf("get %d: result %d value %d\n", i, r, item.value);
+	    ok = 0;
+	}
+    }
+    r = ldb_scan(&db, 0, count_item, 0);
+    printf("scan result %d, right items %d\n", r, scanned);
+    ok &= r == LDB_OK && scanned == ITEMS_COUNT;
+    r = ldb_verify(&db, 0);
+    printf("verify result %d\n", r);
+    ok &= r == LDB_OK;
+
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
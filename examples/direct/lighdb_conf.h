@@ -0,0 +1,57 @@
+#ifndef LIGHDB_CONF_H
+#define LIGHDB_CONF_H
+
+//Settings of examples with lighdb_direct.c
+
+//change for your file system library. F.e. for ElmChan's FatFS define LDB_FILE FIL. For STDIO it will be int
+//O_DIRECT IO with lighdb_direct.c
+#include "lighdb_direct.h"
+#define LDB_FILE ldb_direct_file
+
+//Will library be read only
+#define LDB_READ_ONLY 0
+
+//Change to 1 if you want to log changes for replication, see ldb_changelog_open()
+#define LDB_CHANGELOG 1
+
+//Change to 1 if you want to keep summary of ID table pages, see ldb_summary_open()
+#define LDB_SUMMARY 1
+
+//Change to 1 if you want to create and open DBs with CRC32C checksums, see ldb_create_ex()
+#define LDB_CRC 1
+
+//Change to 1 if you want to create and open DBs with items split to fields, see ldb_create_pax()
+#define LDB_PAX 1
+
+//Change to 1 if you want to create and open DBs with bit packed ID table, see LDB_F_PACKED_IDS
+#define LDB_ID_PACK 1
+
+//Change to 1 if your IO can read ahead in background and implement ldb_io_readahead()
+#define LDB_IO_READAHEAD 1
+
+//Change to 1 if DB is opened by several processes, see ldb_share(). Requires mutexes
+//which work between processes and ldb_io_sync(), f.e. lighdb_shm.c with lighdb_pthread.c
+#define LDB_SHARED 0
+
+//Change to 1 if you want use mutexes and change defines below and implement functions
+#define LDB_MUTEX 0
+
+#if LDB_MUTEX == 1
+//#include "FreeRTOS.h"
+//#include "semphr.h"
+//#include <pthread.h>
+#include <stdint.h>
+#define LDB_MUTEX_t int//SemaphoreHandle_t or pthread_mutex_t //change for your OS
+//implement that functions for your OS or use lighdb_freertos.c or lighdb_pthread.c
+
+//create mutex object
+uint8_t ldb_mutex_create (LDB_MUTEX_t *sobj);
+//delete mutex
+uint8_t ldb_mutex_delete (LDB_MUTEX_t *sobj);
+//Request Grant to Access some object
+uint8_t ldb_mutex_request_grant (LDB_MUTEX_t *sobj);
+//Release Grant to Access the Volume
+uint8_t ldb_mutex_release_grant (LDB_MUTEX_t *sobj);
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Keeps several tables in one pair of files with LighDBEnv.
+//Tables share buffer of env, so it is switched between them
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+LighDBEnv env;
+LighDB temp, events, log_table;
+uint32_t envbuf[1024/4]; //must fit page of table with LDB_F_CRC
+
+//check item of table by ID
+static int check(LighDB *db, uint32_t id, int32_t value)
+{
+    item_t item;
+    LDB_RES r = ldb_get(db, id, (uint8_t*)&item, sizeof(item));
+    if(r != LDB_OK || item.value != value) {
+	printf("get %d: result %d value %d, expected %d\n", id, r, item.value, value);
+	return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    int ok = 1;
+    r = ldb_env_create(&env, "env.ind", "env.dat", 3);
+    printf("create env result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_env_set_buffer(&env, envbuf, sizeof(envbuf));
+
+    r = ldb_env_create_table(&env, &temp, "temp", sizeof(item_t), 0, 0, 0, 300);
+    printf("create table result %d\n", r);
+    ok &= r == LDB_OK;
+    r = ldb_env_create_table(&env, &events, "events", sizeof(item_t), 0, 0, LDB_F_CRC, 300);
+    printf("create table result %d\n", r);
+    ok &= r == LDB_OK;
+    r = ldb_env_create_table(&env, &log_table, "temp", sizeof(item_t), 0, 0, 0, 10);
+    printf("create table with used name result %d\n", r);
+    ok &= r == LDB_ERR;
+    r = ldb_env_create_table(&env, &log_table, "log", sizeof(item_t), 0, 0, 0, 10);
+    printf("create table result %d\n", r);
+    ok &= r == LDB_OK;
+    // catalog has room for 3 tables
+    LighDB extra;
+    r = ldb_env_create_table(&env, &extra, "extra", sizeof(item_t), 0, 0, 0, 10);
+    printf("create table in full catalog result %d\n", r);
+    ok &= r == LDB_ERR_FULL;
+
+    // tables take buffer of env from each other between adds and finds
+    for (uint32_t i = 0; i < 300; i++) {
+	item_t item = {i % 4, (int32_t)i};
+	ldb_add(&temp, &item, sizeof(item), i, 0);
+	item.value = -(int32_t)i;
+	ldb_add(&events, &item, sizeof(item), 299 - i, 0);
+	if(i % 50 == 49)
+	    ok &= check(&temp, i / 2, i / 2) && check(&events, 299 - i / 3, -(int32_t)(i / 3));
+    }
+    item_t item = {0, 0};
+    r = ldb_add(&temp, &item, sizeof(item), 300, 0);
+    printf("add to full table result %d\n", r);
+    ok &= r == LDB_ERR_FULL;
+    for (uint32_t i = 0; i < 10; i++)
+	ldb_add(&log_table, &item, sizeof(item), i, 0);
+    ok &= temp.h.count == 300 && events.h.count == 300 && log_table.h.count == 10;
+
+    r = ldb_env_close(&env);
+    printf("close env with opened tables result %d\n", r);
+    ok &= r == LDB_ERR;
+    ldb_close(&temp);
+    ldb_close(&events);
+    ldb_close(&log_table);
+    r = ldb_env_close(&env);
+    printf("close env result %d\n", r);
+    ok &= r == LDB_OK;
+
+    // tables are opened by name
+    r = ldb_env_open(&env, "env.ind", "env.dat");
+    printf("open env result %d, tables %d\n", r, env.h.tables);
+    ok &= r == LDB_OK && env.h.tables == 3;
+    ldb_env_set_buffer(&env, envbuf, sizeof(envbuf));
+    r = ldb_env_open_table(&env, &events, "events");
+    printf("open table result %d, count %d\n", r, events.h.count);
+    ok &= r == LDB_OK && events.h.count == 300;
+    r = ldb_env_open_table(&env, &temp, "temp");
+    printf("open table result %d, count %d\n", r, temp.h.count);
+    ok &= r == LDB_OK && temp.h.count == 300;
+    r = ldb_env_open_table(&env, &log_table, "nothing");
+    printf("open unknown table result %d\n", r);
+    ok &= r == LDB_ERR_NO_ID;
+    for (uint32_t i = 0; i < 300; i += 7)
+	ok &= check(&events, i, -(int32_t)(299 - i)) && check(&temp, i, i);
+    r = ldb_verify(&events, 0);
+    printf("verify result %d\n", r);
+    ok &= r == LDB_OK;
+
+    ldb_close(&temp);
+    ldb_close(&events);
+    ldb_env_close(&env);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Gets items with the same ID page by page with ldb_find_begin() and ldb_find_next().
+//Items added between pages are found too
+
+typedef struct {
+    uint32_t id;
+    int32_t value;
+} item_t;
+
+#define ITEMS_COUNT 1000
+#define PAGE 8
+
+LighDB db;
+uint32_t dbbuf[256/4];
+
+//find all items with id by pages, adding added items with id after every of first pages.
+//Returns count of found items or 0 if some of them are wrong
+static uint32_t find_all(uint32_t id, uint32_t added)
+{
+    LDB_FIND f;
+    uint32_t count, list[PAGE], found = 0, prev = 0;
+    ldb_find_begin(&db, &f, id);
+    do {
+	LDB_RES r = ldb_find_next(&f, &count, list, PAGE);
+	if(r != LDB_OK)
+	    return 0;
+	for (uint32_t k = 0; k < count; k++) {
+	    item_t item;
+	    ldb_get_ind(&db, list[k], (uint8_t*)&item, sizeof(item));
+	    //indexes grow and every item has ID
+	    if(item.id != id || (found + k != 0 && list[k] <= prev))
+		return 0;
+	    prev = list[k];
+	}
+	found += count;
+	if(added != 0) {
+	    item_t item = {id, -1};
+	    ldb_add(&db, &item, sizeof(item), id, 0);
+	    added --;
+	}
+    } while(count == PAGE);
+    return found;
+}
+
+static int test(char *name, uint32_t flags, uint32_t ids)
+{
+    int ok = 1;
+    uint32_t n;
+    LDB_RES r = ldb_create_ex(&db, "cursor.ind", "cursor.dat", sizeof(item_t), 0, 0, flags);
+    if(r != LDB_OK)
+	return 0;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    // sorted table has ITEMS_COUNT / ids items for every ID one after another,
+    // unsorted has ids IDs one by one again and again
+    for (uint32_t i = 0; i < ITEMS_COUNT; i++) {
+	item_t item = {flags ? i / (ITEMS_COUNT / ids) : i % ids, (int32_t)i};
+	ldb_add(&db, &item, sizeof(item), item.id, 0);
+    }
+    printf("%s: sorted %d\n", name, (db.h.flags & LDB_F_SORTED) != 0);
+    ok &= ((db.h.flags & LDB_F_SORTED) != 0) == (flags != 0);
+
+    // last ID, its new items are added at the end
+    n = find_all(ids - 1, 5);
+    printf("%s: found %d of last ID\n", name, n);
+    ok &= n == ITEMS_COUNT / ids + 5;
+    // ID in the middle, items of other ID are added between pages.
+    // Its items fill whole pages, so end of search is page without items
+    LDB_FIND f;
+    uint32_t count, list[PAGE];
+    n = 0;
+    ldb_find_begin(&db, &f, 3);
+    do {
+	item_t item = {ids - 1, -1};
+	ldb_find_next(&f, &count, list, PAGE);
+	ldb_add(&db, &item, sizeof(item), item.id, 0);
+	n += count;
+    } while(count == PAGE);
+    printf("%s: found %d of ID 3\n", name, n);
+    ok &= n == ITEMS_COUNT / ids;
+    // no such ID
+    ldb_find_begin(&db, &f, ids + 100);
+    r = ldb_find_next(&f, &count, list, PAGE);
+    printf("%s: found %d of absent ID\n", name, count);
+    ok &= r == LDB_OK && count == 0;
+    // page must have room for indexes
+    ldb_find_begin(&db, &f, 3);
+    r = ldb_find_next(&f, &count, list, 0);
+    ok &= r == LDB_ERR_SMALL_BUFFER;
+
+    ldb_close(&db);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int ok = 1;
+    ok &= test("sorted", LDB_F_SORTED, 25);
+    ok &= test("unsorted", 0, 25);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Keeps sorted ID table packed by blocks of LDB_PACK_IDS IDs, so it is several times smaller.
+//Directory of blocks grows when items are added.
+//Needs LDB_ID_PACK 1 in lighdb_conf.h
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+#define ITEMS_COUNT 5000 //directory grows more than once
+
+LighDB db;
+uint32_t dbbuf[1024/4]; //must fit LDB_PACK_IDS IDs
+
+//check that every ID is found at its items
+static int check(void)
+{
+    int ok = 1;
+    for (uint32_t id = 0; id < ITEMS_COUNT / 2 + 10; id++) {
+	uint32_t count, list[4];
+	LDB_RES r = ldb_find_by_id(&db, id, &count, list, 4);
+	uint32_t expected = id < ITEMS_COUNT / 2 ? 2 : 0;
+	if(r != LDB_OK || count != expected || (count != 0 && list[0] != id * 2)) {
+	    printf("%d: result %d count %d, expected %d\n", id, r, count, expected);
+	    ok = 0;
+	}
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    r = ldb_create_ex(&db, "packed.ind", "packed.dat", sizeof(item_t), 0, 0, LDB_F_PACKED_IDS);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    r = ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    printf("set buffer result %d\n", r);
+
+    // two items for every ID
+    for (uint32_t i = 0; i < ITEMS_COUNT; i++) {
+	item_t item = {i % 4, (int32_t)i};
+	r = ldb_add(&db, &item, sizeof(item), i / 2, 0);
+	if(r != LDB_OK) {
+	    printf("add result %d\n", r);
+	    return 1;
+	}
+    }
+
+    int ok = check();
+    printf("find %s\n", ok ? "ok" : "FAILED");
+    ldb_close(&db);
+
+    r = ldb_open(&db, "packed.ind", "packed.dat");
+    printf("open result %d, count %d\n", r, db.h.count);
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    ok &= r == LDB_OK && db.h.count == ITEMS_COUNT && check();
+
+    item_t item;
+    r = ldb_get(&db, ITEMS_COUNT / 2 - 1, (uint8_t*)&item, sizeof(item));
+    printf("get result %d, value %d\n", r, item.value);
+    ok &= r == LDB_OK && item.value == ITEMS_COUNT - 2;
+
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
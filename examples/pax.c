@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include "lighdb.h"
+
+//Same items are kept in table of rows and in table with LDB_F_PAX, where every field
+//is stored in its own part of block. Every function must give same results for both.
+//Needs LDB_PAX 1 in lighdb_conf.h
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+    uint8_t tag[8];
+} item_t;
+
+#define ITEMS_COUNT 300 //last block of LDB_PAX_BLOCK items isn't full
+
+LighDB rows, pax;
+uint32_t rowsbuf[512/4];
+uint32_t paxbuf[512/4];
+
+//sum of matched items by scan callback
+typedef struct {
+    uint32_t count;
+    uint32_t hash;
+} scan_res_t;
+
+static uint8_t scan_cb(uint32_t index, uint8_t *item, uint32_t size, void *arg)
+{
+    scan_res_t *res = arg;
+    res->count++;
+    res->hash = res->hash * 31 + index;
+    for (uint32_t i = 0; i < size; i++)
+	res->hash = res->hash * 31 + item[i];
+    return 0;
+}
+
+static item_t make_item(uint32_t i, int32_t value)
+{
+    item_t item = {i % 5, value, {0}};
+    snprintf((char*)item.tag, sizeof(item.tag), "t%u", i);
+    return item;
+}
+
+//results of every read function are compared
+static int compare(void)
+{
+    int ok = 1;
+    item_t a[20], b[20];
+    LDB_RES ra, rb;
+    for (uint32_t id = 0; id < ITEMS_COUNT / 2 + 5; id += 3) {
+	memset(a, 0, sizeof(item_t));
+	memset(b, 0, sizeof(item_t));
+	ra = ldb_get(&rows, id, (uint8_t*)a, sizeof(item_t));
+	rb = ldb_get(&pax, id, (uint8_t*)b, sizeof(item_t));
+	if(ra != rb || memcmp(a, b, sizeof(item_t))) {
+	    printf("get %d: result %d and %d\n", id, ra, rb);
+	    ok = 0;
+	}
+    }
+    //ranges cross borders of blocks
+    for (uint32_t index = 0; index < ITEMS_COUNT; index += 17) {
+	uint32_t count = index + 20 > ITEMS_COUNT ? ITEMS_COUNT - index : 20;
+	ra = ldb_get_range(&rows, index, count, (uint8_t*)a, sizeof(a));
+	rb = ldb_get_range(&pax, index, count, (uint8_t*)b, sizeof(b));
+	if(ra != LDB_OK || rb != LDB_OK || memcmp(a, b, count * sizeof(item_t))) {
+	    printf("get range %d: result %d and %d\n", index, ra, rb);
+	    ok = 0;
+	}
+    }
+    //scan of all items and scan with predicate on field value
+    int32_t limit = 100;
+    LDB_PRED pred = {0, 0, 4, 0, LDB_T_I32, LDB_GT, &limit};
+    LDB_PRED *preds[2] = {0, &pred};
+    for (int p = 0; p < 2; p++) {
+	scan_res_t sa = {0, 0}, sb = {0, 0};
+	ra = ldb_scan(&rows, preds[p], scan_cb, &sa);
+	rb = ldb_scan(&pax, preds[p], scan_cb, &sb);
+	printf("scan %d: result %d and %d, count %d and %d\n",
+	       p, ra, rb, sa.count, sb.count);
+	if(ra != LDB_OK || rb != LDB_OK || sa.count != sb.count ||
+	   sa.hash != sb.hash || sa.count == 0)
+	    ok = 0;
+    }
+    //aggregates of field value over part of table
+    LDB_AGG ops[4] = {LDB_AGG_COUNT, LDB_AGG_SUM, LDB_AGG_MIN, LDB_AGG_MAX};
+    for (int i = 0; i < 4; i++) {
+	LDB_AGG_RES ga, gb;
+	ra = ldb_aggregate(&rows, 4, LDB_T_I32, ops[i], 10, ITEMS_COUNT + 10, &ga);
+	rb = ldb_aggregate(&pax, 4, LDB_T_I32, ops[i], 10, ITEMS_COUNT + 10, &gb);
+	printf("aggregate %d: result %d and %d, count %d, value %d and %d\n",
+	       ops[i], ra, rb, ga.count, (int)ga.v.i, (int)gb.v.i);
+	if(ra != LDB_OK || rb != LDB_OK || ga.count != gb.count ||
+	   (ops[i] != LDB_AGG_COUNT && ga.v.i != gb.v.i))
+	    ok = 0;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    LDB_FIELD fields[3] = {{0, 4}, {4, 4}, {8, 8}};
+    r = ldb_create(&rows, "pax_rows.ind", "pax_rows.dat", sizeof(item_t), 0, 0);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    r = ldb_create_pax(&pax, "pax.ind", "pax.dat", sizeof(item_t), 0, 0, 0, fields, 3);
+    printf("create pax result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&rows, rowsbuf, sizeof(rowsbuf));
+    ldb_set_buffer(&pax, paxbuf, sizeof(paxbuf));
+
+    //two items for every ID
+    for (uint32_t i = 0; i < ITEMS_COUNT; i++) {
+	item_t item = make_item(i, (int32_t)(i * 7 % 251) - 60);
+	ldb_add(&rows, &item, sizeof(item), i / 2, 0);
+	if((r = ldb_add(&pax, &item, sizeof(item), i / 2, 0)) != LDB_OK) {
+	    printf("add result %d\n", r);
+	    return 1;
+	}
+    }
+    int ok = compare();
+
+    //items changed by index and by ID
+    for (uint32_t i = 0; i < ITEMS_COUNT; i += 13) {
+	item_t item = make_item(i + 1000, -(int32_t)i);
+	ldb_upd_ind(&rows, i, &item, sizeof(item));
+	if((r = ldb_upd_ind(&pax, i, &item, sizeof(item))) != LDB_OK) {
+	    printf("upd ind result %d\n", r);
+	    ok = 0;
+	}
+	item.value = 1000 + (int32_t)i;
+	ldb_upd(&rows, i / 3, &item, sizeof(item));
+	if((r = ldb_upd(&pax, i / 3, &item, sizeof(item))) != LDB_OK) {
+	    printf("upd result %d\n", r);
+	    ok = 0;
+	}
+    }
+    ok &= compare();
+
+    //reopened table with LDB_F_PAX reads its fields
+    ldb_close(&pax);
+    r = ldb_open(&pax, "pax.ind", "pax.dat");
+    printf("open pax result %d, flags %d\n", r, pax.h.flags);
+    if(r != LDB_OK || (pax.h.flags & LDB_F_PAX) == 0)
+	return 1;
+    ldb_set_buffer(&pax, paxbuf, sizeof(paxbuf));
+    ok &= compare();
+
+    ldb_close(&rows);
+    ldb_close(&pax);
+    printf(ok ? "pax ok\n" : "pax failed\n");
+    return ok ? 0 : 1;
+}
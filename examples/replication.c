@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <string.h>
+#include "lighdb.h"
+
+//Keeps follower DB up to date with leader using change log.
+//Needs LDB_CHANGELOG 1 in lighdb_conf.h
+
+LighDB leader, follower;
+uint32_t leader_buf[512/4];
+uint32_t follower_buf[512/4];
+#define ITEM_SIZE 10
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    int ok = 1;
+    uint32_t seq = 0; //last change applied to follower
+    // both DBs are created empty, so follower is a copy of leader
+    r = ldb_create(&leader, "leader.ind", "leader.dat", ITEM_SIZE, 4, (uint8_t*)"v001");
+    printf("create leader result %d\n", r);
+    ldb_set_buffer(&leader, leader_buf, sizeof(leader_buf));
+    r = ldb_create(&follower, "follower.ind", "follower.dat", ITEM_SIZE, 4, (uint8_t*)"v001");
+    printf("create follower result %d\n", r);
+    ldb_set_buffer(&follower, follower_buf, sizeof(follower_buf));
+
+    // log every change of leader
+    r = ldb_changelog_open(&leader, "leader.log", 1);
+    printf("changelog open result %d\n", r);
+
+    ldb_add(&leader, "0123456789", ITEM_SIZE, 13, 0);
+    ldb_add(&leader, "asdfdsffdd", ITEM_SIZE, 7, 0);
+    // ship first changes
+    r = ldb_apply_changes(&leader, &follower, seq, &seq);
+    printf("apply result %d, last change %d\n", r, seq);
+    ok &= r == LDB_OK;
+
+    ldb_upd_ind(&leader, 0, "9876543210", ITEM_SIZE);
+    ldb_set_header(&leader, (uint8_t*)"v002", 4, 0);
+    ldb_add(&leader, "1234567890", ITEM_SIZE, 14, 0);
+    // ship only changes after seq
+    r = ldb_apply_changes(&leader, &follower, seq, &seq);
+    printf("apply result %d, last change %d\n", r, seq);
+    ok &= r == LDB_OK;
+
+    // compare items
+    ok &= follower.h.count == leader.h.count;
+    uint8_t a[ITEM_SIZE], b[ITEM_SIZE];
+    for (uint32_t i = 0; i < leader.h.count; i++) {
+	ldb_get_ind(&leader, i, a, ITEM_SIZE);
+	r = ldb_get_ind(&follower, i, b, ITEM_SIZE);
+	int same = r == LDB_OK && memcmp(a, b, ITEM_SIZE) == 0;
+	printf("%d: %.10s %s\n", i, b, same ? "same" : "DIFFERENT");
+	ok &= same;
+    }
+
+    ldb_close(&leader); //closes change log too
+    ldb_close(&follower);
+    return ok ? 0 : 1;
+}
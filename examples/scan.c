@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Finds items by value of field with ldb_scan() and built-in predicate
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+LighDB db;
+uint32_t dbbuf[512/4];
+
+//called for every matched item
+uint8_t print_item(uint32_t index, uint8_t *data, uint32_t size, void *arg)
+{
+    item_t *item = (item_t*)data;
+    printf("%d: sensor %d value %d\n", index, item->sensor, item->value);
+    (*(uint32_t*)arg) ++;
+    return 0; //continue scan
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    r = ldb_create(&db, "scan.ind", "scan.dat", sizeof(item_t), 0, 0);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+
+    for (uint32_t i = 0; i < 100; i++) {
+	item_t item = {i % 4, (int32_t)i - 50};
+	ldb_add(&db, &item, sizeof(item), item.sensor, 0);
+    }
+
+    // items with value >= 40
+    int32_t min = 40;
+    LDB_PRED pred = {0};
+    pred.offset = 4;       // offset of value in item
+    pred.type = LDB_T_I32; // type of value
+    pred.op = LDB_GE;
+    pred.value = &min;
+    uint32_t found = 0;
+    r = ldb_scan(&db, &pred, print_item, &found);
+    printf("scan result %d, found %d\n", r, found);
+
+    ldb_close(&db);
+    return (r == LDB_OK && found == 10) ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L //for shm_open
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "lighdb.h"
+
+//Several processes add items to one DB through block in shared memory by ldb_shm_open().
+//Last process removes block, so DB created again gets new block
+
+typedef struct {
+    uint32_t writer;
+    int32_t value;
+} item_t;
+
+#define WRITERS 4
+#define WRITER_ITEMS 500
+
+char name[64]; //name of shared memory block
+
+//process adds WRITER_ITEMS items, returns 0 if all are added and found
+static int writer(uint32_t w)
+{
+    LighDB db;
+    if(ldb_open(&db, "shared.ind", "shared.dat") ||
+       ldb_shm_open(&db, name, 1024))
+	return 1;
+    int ok = 1;
+    for (uint32_t i = 0; i < WRITER_ITEMS; i++) {
+	item_t item = {w, (int32_t)i};
+	uint32_t count, index;
+	ok &= ldb_add(&db, &item, sizeof(item), w * 1000 + i, 0) == LDB_OK;
+	ok &= ldb_find_by_id(&db, w * 1000 + i, &count, &index, 1) == LDB_OK && count == 1;
+    }
+    ok &= ldb_shm_close(&db, name) == LDB_OK;
+    return ok ? 0 : 1;
+}
+
+//run writers in processes and wait for them
+static int run_writers(void)
+{
+    int ok = 1, status;
+    for (uint32_t w = 0; w < WRITERS; w++)
+	if(fork() == 0)
+	    _exit(writer(w));
+    for (uint32_t w = 0; w < WRITERS; w++) {
+	wait(&status);
+	ok &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+}
+
+//result of ldb_shm_open() in other process
+static LDB_RES attach_in_process(void)
+{
+    int status;
+    if(fork() == 0) {
+	LighDB db;
+	ldb_open(&db, "shared.ind", "shared.dat");
+	LDB_RES r = ldb_shm_open(&db, name, 1024);
+	if(r == LDB_OK)
+	    ldb_shm_close(&db, name);
+	else
+	    ldb_close(&db);
+	_exit(r);
+    }
+    wait(&status);
+    return WEXITSTATUS(status);
+}
+
+static int create_db(void)
+{
+    LighDB db;
+    remove("shared.ind");
+    remove("shared.dat");
+    if(ldb_create_ex(&db, "shared.ind", "shared.dat", sizeof(item_t), 0, 0, LDB_F_CRC))
+	return 0;
+    return ldb_close(&db) == LDB_OK;
+}
+
+//check count of items and items of every writer
+static int check(uint32_t count)
+{
+    LighDB db;
+    uint32_t buf[1024/4];
+    int ok = ldb_open(&db, "shared.ind", "shared.dat") == LDB_OK;
+    ldb_set_buffer(&db, buf, sizeof(buf));
+    printf("count %d, expected %d\n", db.h.count, count);
+    ok &= db.h.count == count && ldb_verify(&db, 0) == LDB_OK;
+    for (uint32_t w = 0; w < WRITERS && count != 0; w++)
+	for (uint32_t i = 0; i < WRITER_ITEMS; i += 7) {
+	    item_t item;
+	    ok &= ldb_get(&db, w * 1000 + i, (uint8_t*)&item, sizeof(item)) == LDB_OK &&
+		item.writer == w && item.value == (int32_t)i;
+	}
+    ldb_close(&db);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int ok = 1;
+    LDB_RES r;
+    snprintf(name, sizeof(name), "/lighdb_example_%d", (int)getpid());
+
+    ok &= create_db() && run_writers() && check(WRITERS * WRITER_ITEMS);
+    // block was removed by last writer, DB created again starts from 0
+    ok &= create_db() && run_writers() && check(WRITERS * WRITER_ITEMS);
+
+    // DB is created again while this process uses block of old DB
+    LighDB old;
+    ldb_open(&old, "shared.ind", "shared.dat");
+    r = ldb_shm_open(&old, name, 1024);
+    ok &= r == LDB_OK && create_db();
+    r = attach_in_process();
+    printf("attach to block of old DB result %d\n", r);
+    ok &= r == LDB_ERR_HEADER;
+    ldb_shm_close(&old, name);
+    r = attach_in_process();
+    printf("attach after old DB is closed result %d\n", r);
+    ok &= r == LDB_OK;
+
+    // process which creates block crashed before block is ready
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    ok &= fd >= 0 && ftruncate(fd, sizeof(LDB_SHARED_BLOCK) + 1024) == 0;
+    close(fd);
+    r = attach_in_process();
+    printf("attach to block which isn't ready result %d\n", r);
+    ok &= r == LDB_ERR;
+    ok &= ldb_shm_unlink(name) == LDB_OK;
+    ok &= run_writers() && check(WRITERS * WRITER_ITEMS);
+
+    return ok ? 0 : 1;
+}
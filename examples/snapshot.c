@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Reads consistent view of DB with snapshot while items are updated and added.
+//Old versions of updated items are kept in undo storage
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+LighDB db;
+uint32_t dbbuf[512/4];
+uint8_t undo[4 * (4 + sizeof(item_t))]; //for 4 updated items
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    r = ldb_create(&db, "snapshot.ind", "snapshot.dat", sizeof(item_t), 0, 0);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+
+    for (uint32_t i = 0; i < 100; i++) {
+	item_t item = {i % 4, (int32_t)i};
+	ldb_add(&db, &item, sizeof(item), item.sensor, 0);
+    }
+
+    int ok = 1;
+    LDB_SNAPSHOT snap;
+    r = ldb_snapshot_begin(&db, &snap, undo, sizeof(undo));
+    printf("snapshot result %d, count %d\n", r, snap.count);
+    ok &= r == LDB_OK && snap.count == 100;
+
+    // changes after begin aren't visible in snapshot
+    item_t item = {0, 1000};
+    ldb_upd_ind(&db, 10, &item, sizeof(item));
+    ldb_upd_ind(&db, 10, &item, sizeof(item)); // old version is saved once
+    ldb_add(&db, &item, sizeof(item), 0, 0);
+
+    item_t old, cur;
+    r = ldb_snapshot_get_ind(&snap, 10, (uint8_t*)&old, sizeof(old));
+    ldb_get_ind(&db, 10, (uint8_t*)&cur, sizeof(cur));
+    printf("get result %d, snapshot value %d, current value %d\n", r, old.value, cur.value);
+    ok &= r == LDB_OK && old.value == 10 && cur.value == 1000;
+
+    LDB_AGG_RES sum;
+    r = ldb_snapshot_aggregate(&snap, 4, LDB_T_I32, LDB_AGG_SUM, 0, 1000, &sum);
+    printf("aggregate result %d, count %d, sum %d, saved %d\n",
+	   r, sum.count, (int)sum.v.i, snap.undo_count);
+    ok &= r == LDB_OK && sum.count == 100 && sum.v.i == 4950 && snap.undo_count == 1;
+
+    ldb_snapshot_end(&snap);
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+#include "lighdb.h"
+
+//IDs added in ascending order keep LDB_F_SORTED, so ID table is searched by binary search.
+//Table created by ldb_create_ex() with LDB_F_SORTED keeps it after reopen
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+#define ITEMS_COUNT 3000
+
+LighDB db;
+uint32_t dbbuf[256/4];
+
+//every ID has two items, get returns first of them
+static int check(void)
+{
+    int ok = 1;
+    for (uint32_t id = 0; id < ITEMS_COUNT / 2; id += 7) {
+	item_t item;
+	LDB_RES r = ldb_get(&db, id, (uint8_t*)&item, sizeof(item));
+	if(r != LDB_OK || item.value != (int32_t)id * 2) {
+	    printf("get %d: result %d value %d\n", id, r, item.value);
+	    ok = 0;
+	}
+    }
+    return ok;
+}
+
+static int fill(void)
+{
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    for (uint32_t i = 0; i < ITEMS_COUNT; i++) {
+	item_t item = {i % 4, (int32_t)i};
+	ldb_add(&db, &item, sizeof(item), i / 2, 0);
+    }
+    return check();
+}
+
+static int reopen(void)
+{
+    ldb_close(&db);
+    LDB_RES r = ldb_open(&db, "sorted.ind", "sorted.dat");
+    printf("open result %d, version %.9s, sorted %d\n", r, db.h.version,
+	   (db.h.flags & LDB_F_SORTED) != 0);
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    return r == LDB_OK && check();
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    int ok = 1;
+    r = ldb_create_ex(&db, "sorted.ind", "sorted.dat", sizeof(item_t), 0, 0, LDB_F_SORTED);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ok &= fill() && (db.h.flags & LDB_F_SORTED);
+    ok &= reopen() && (db.h.flags & LDB_F_SORTED) && memcmp(db.h.version, "LighDB002", 9) == 0;
+
+    // the same ID again keeps order, smaller ID clears it forever
+    item_t item = {0, ITEMS_COUNT};
+    ldb_add(&db, &item, sizeof(item), ITEMS_COUNT / 2 - 1, 0);
+    ok &= (db.h.flags & LDB_F_SORTED) != 0;
+    ldb_add(&db, &item, sizeof(item), 0, 0);
+    printf("sorted after smaller ID %d\n", (db.h.flags & LDB_F_SORTED) != 0);
+    ok &= (db.h.flags & LDB_F_SORTED) == 0;
+    ok &= reopen() && (db.h.flags & LDB_F_SORTED) == 0;
+    ldb_close(&db);
+
+    // ldb_create() writes version 001 without flags, it isn't sorted after reopen
+    r = ldb_create(&db, "sorted.ind", "sorted.dat", sizeof(item_t), 0, 0);
+    ok &= r == LDB_OK && fill() && (db.h.flags & LDB_F_SORTED);
+    ok &= reopen() && (db.h.flags & LDB_F_SORTED) == 0 && memcmp(db.h.version, "LighDB001", 9) == 0;
+
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
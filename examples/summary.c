@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Summary keeps min, max and bloom filter of every LDB_SUMMARY_IDS IDs of unsorted ID table,
+//so search of ID skips pages which can't contain it.
+//Needs LDB_SUMMARY 1 in lighdb_conf.h
+
+#define PAGES 3
+#define ITEMS_COUNT (PAGES * LDB_SUMMARY_IDS)
+#define ABSENT_ID 7000 //between IDs of page 0 and page 1
+
+LighDB db;
+uint32_t dbbuf[4096/4]; //must fit LDB_SUMMARY_IDS IDs
+
+//IDs of page are page * 10000 + 0..4 * LDB_SUMMARY_IDS in mixed order
+static uint32_t item_id(uint32_t i)
+{
+    uint32_t page = i / LDB_SUMMARY_IDS;
+    return page * 10000 + (i % LDB_SUMMARY_IDS * 37 % LDB_SUMMARY_IDS) * 4;
+}
+
+//count of items written in header of summary file
+static uint32_t summary_count(void)
+{
+    uint32_t count = 0;
+    FILE *f = fopen("summary.sum", "rb");
+    if(f == NULL)
+	return 0;
+    if(fseek(f, 18, SEEK_SET) || fread(&count, 4, 1, f) != 1)
+	count = 0;
+    fclose(f);
+    return count;
+}
+
+//write ids to ID table of page 1, DB is closed
+static int write_page1(uint32_t offset, uint32_t same_id)
+{
+    FILE *f = fopen("summary.ind", "r+b");
+    int ok = f != NULL && fseek(f, offset + LDB_SUMMARY_IDS * 4, SEEK_SET) == 0;
+    for (uint32_t i = LDB_SUMMARY_IDS; ok && i < 2 * LDB_SUMMARY_IDS; i++) {
+	uint32_t id = same_id ? same_id : item_id(i);
+	ok = fwrite(&id, 4, 1, f) == 1;
+    }
+    if(f != NULL)
+	fclose(f);
+    return ok;
+}
+
+static uint32_t find_count(uint32_t id)
+{
+    uint32_t count = 0, list[4];
+    LDB_RES r = ldb_find_by_id(&db, id, &count, list, 4);
+    return r == LDB_OK ? count : 0xFFFFFFFF;
+}
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    int ok = 1;
+    r = ldb_create(&db, "summary.ind", "summary.dat", sizeof(uint32_t), 0, 0);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    r = ldb_summary_open(&db, "summary.sum", 1);
+    printf("summary open result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    for (uint32_t i = 0; i < ITEMS_COUNT; i++)
+	if((r = ldb_add(&db, &i, sizeof(i), item_id(i), 0)) != LDB_OK) {
+	    printf("add result %d\n", r);
+	    return 1;
+	}
+    uint32_t offset = db.index_offset;
+    ldb_close(&db);
+    //ldb_add() updated summary
+    printf("summary count %d of %d\n", summary_count(), ITEMS_COUNT);
+    if(summary_count() != ITEMS_COUNT)
+	ok = 0;
+
+    //IDs of page 1 are changed to absent ID behind the library,
+    //count is the same, so summary isn't rebuilt and page 1 is skipped
+    if(!write_page1(offset, ABSENT_ID))
+	return 1;
+    ldb_open(&db, "summary.ind", "summary.dat");
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    r = ldb_summary_open(&db, "summary.sum", 0);
+    uint32_t skipped = find_count(ABSENT_ID);
+    ldb_summary_close(&db);
+    uint32_t read = find_count(ABSENT_ID);
+    printf("summary open result %d, absent ID found %d times with summary, %d without\n",
+	   r, skipped, read);
+    if(r != LDB_OK || skipped != 0 || read != 4)
+	ok = 0;
+    ldb_close(&db);
+    if(!write_page1(offset, 0))
+	return 1;
+
+    //items added without summary, so its count doesn't match and it is rebuilt
+    ldb_open(&db, "summary.ind", "summary.dat");
+    ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    for (uint32_t i = ITEMS_COUNT; i < ITEMS_COUNT + 100; i++)
+	ldb_add(&db, &i, sizeof(i), item_id(i), 0);
+    r = ldb_summary_open(&db, "summary.sum", 0);
+    printf("summary open result %d, count %d of %d\n",
+	   r, db.sum_count, db.h.count);
+    if(r != LDB_OK || db.sum_count != ITEMS_COUNT + 100)
+	ok = 0;
+
+    //summary is updated by ldb_add() again
+    uint32_t i = ITEMS_COUNT + 100;
+    ldb_add(&db, &i, sizeof(i), 99999, 0);
+    ldb_summary_close(&db);
+    printf("summary count %d after add\n", summary_count());
+    if(summary_count() != ITEMS_COUNT + 101)
+	ok = 0;
+
+    //every item is found with summary, absent ID isn't
+    ldb_summary_open(&db, "summary.sum", 0);
+    for (uint32_t i = 0; i < ITEMS_COUNT + 100; i++) {
+	uint32_t value;
+	if(ldb_get(&db, item_id(i), (uint8_t*)&value, sizeof(value)) != LDB_OK ||
+	   value != i) {
+	    printf("get %d: value %d, expected %d\n", item_id(i), value, i);
+	    ok = 0;
+	    break;
+	}
+    }
+    printf("ID 99999 found %d times, absent ID %d times\n",
+	   find_count(99999), find_count(ABSENT_ID));
+    if(find_count(99999) != 1 || find_count(ABSENT_ID) != 0)
+	ok = 0;
+    ldb_close(&db);
+    printf(ok ? "summary ok\n" : "summary failed\n");
+    return ok ? 0 : 1;
+}
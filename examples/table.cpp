@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <iterator>
+#include <ranges>
+#include <utility>
+#include "lighdb.hpp"
+
+//Typed table of C++ wrapper lighdb.hpp. Needs C++20
+
+struct Item {
+    uint32_t sensor;
+    double value;
+};
+
+using ItemTable = lighdb::Table<Item>;
+static_assert(std::input_iterator<ItemTable::Iterator<>>);
+static_assert(std::sentinel_for<std::default_sentinel_t, ItemTable::Iterator<>>);
+static_assert(std::ranges::input_range<ItemTable>);
+
+static int ok = 1;
+static void check(bool cond, const char *what)
+{
+    if(!cond) {
+	printf("FAILED: %s\n", what);
+	ok = 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ItemTable t;
+    LDB_RES r = t.create("table.ind", "table.dat");
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+
+    uint32_t ids[100];
+    Item items[100];
+    for (uint32_t i = 0; i < 100; i++) {
+	ids[i] = i % 7;
+	items[i] = {i % 4, i * 0.5};
+    }
+    check(t.add(std::span<const uint32_t>(ids), std::span<const Item>(items)) == LDB_OK, "add");
+    check(t.add(std::span<const uint32_t>(ids, 2), std::span<const Item>(items, 3)) == LDB_ERR_SIZE,
+	  "add of different sizes");
+    check(t.count() == 100, "count");
+
+    // iterator reads items in batches
+    uint32_t n = 0;
+    for (auto it = t.begin(); it != t.end(); ++it) {
+	check(it->value == it.ind() * 0.5, "iterator value");
+	n ++;
+    }
+    check(n == 100, "iterator count");
+
+    // scan with lambda, true stops scan
+    double sum = 0;
+    r = t.scan([&](uint32_t index, const Item &item) {
+	sum += item.value;
+	return index == 9;
+    });
+    check(r == LDB_OK && sum == 22.5, "scan");
+
+    Item item;
+    uint32_t found[32], count;
+    check(t.get(3, item) == LDB_OK && item.value == 1.5, "get");
+    check(t.find(0, found, count) == LDB_OK && count == 15, "find");
+
+    // moved table keeps DB and its buffer
+    ItemTable moved(std::move(t));
+    check(!t.is_open() && moved.is_open() && moved.count() == 100, "move construction");
+    ItemTable other;
+    other = std::move(moved);
+    check(!moved.is_open() && other.get_ind(99, item) == LDB_OK && item.value == 49.5,
+	  "move assignment");
+    other.close();
+
+    // item size of DB must be sizeof(T)
+    lighdb::Table<uint32_t> wrong;
+    check(wrong.open("table.ind", "table.dat") == LDB_ERR_HEADER && !wrong.is_open(),
+	  "open with other item size");
+    ItemTable reopened;
+    check(reopened.open("table.ind", "table.dat") == LDB_OK && reopened.count() == 100,
+	  "open");
+    check(std::ranges::distance(reopened) == 100, "range");
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
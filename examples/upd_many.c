@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include "lighdb.h"
+
+//Changes many items by IDs at once with ldb_upd_many(). Table has checksums,
+//so buffer keeps page of ID table for search and rest of it is split to batches.
+//Needs LDB_CRC 1 in lighdb_conf.h
+
+typedef struct {
+    uint32_t sensor;
+    int32_t value;
+} item_t;
+
+#define UPD_COUNT 40
+
+LighDB db;
+uint32_t dbbuf[600/4]; //512 bytes for page of ID table, 16 bytes for each item of batch
+uint32_t ids[UPD_COUNT];
+item_t items[UPD_COUNT];
+
+int main(int argc, char *argv[])
+{
+    LDB_RES r;
+    r = ldb_create_ex(&db, "upd_many.ind", "upd_many.dat", sizeof(item_t), 0, 0, LDB_F_CRC);
+    printf("create result %d\n", r);
+    if(r != LDB_OK)
+	return 1;
+    r = ldb_set_buffer(&db, dbbuf, sizeof(dbbuf));
+    printf("set buffer result %d\n", r);
+
+    for (uint32_t i = 0; i < 300; i++) {
+	item_t item = {i % 4, (int32_t)i};
+	ldb_add(&db, &item, sizeof(item), i, 0);
+    }
+
+    // IDs in any order
+    for (uint32_t k = 0; k < UPD_COUNT; k++) {
+	ids[k] = 299 - 7 * k;
+	items[k].sensor = ids[k] % 4;
+	items[k].value = ids[k] + 1000;
+    }
+    int ok = 1;
+    r = ldb_upd_many(&db, ids, items, UPD_COUNT, sizeof(items));
+    printf("upd_many result %d\n", r);
+    ok &= r == LDB_OK;
+
+    // changed and neighbour items
+    for (uint32_t id = 0; id < 300; id++) {
+	item_t item;
+	r = ldb_get(&db, id, (uint8_t*)&item, sizeof(item));
+	int32_t expected = (id >= 299 - 7 * (UPD_COUNT - 1) && (299 - id) % 7 == 0) ? id + 1000 : id;
+	if(r != LDB_OK || item.value != expected) {
+	    printf("%d: result %d value %d, expected %d\n", id, r, item.value, expected);
+	    ok = 0;
+	}
+    }
+
+    // nothing of batch is changed if ID isn't found
+    ids[0] = 1000;
+    r = ldb_upd_many(&db, ids, items, 1, sizeof(item_t));
+    printf("upd_many of unknown ID result %d\n", r);
+    ok &= r == LDB_ERR_NO_ID;
+
+    r = ldb_verify(&db, 0);
+    printf("verify result %d\n", r);
+    ok &= r == LDB_OK;
+
+    ldb_close(&db);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE //for O_DIRECT
+#endif
+#include "lighdb.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+//IO with O_DIRECT, without page cache. Use it with LDB_F_ALIGNED DBs and buffer
+//aligned to LDB_DIRECT_ALIGN, then big reads go directly to buffer.
+//Other reads and writes go through aligned buffer of file.
+
+#define ALIGN_DOWN(x) ((x) / LDB_DIRECT_ALIGN * LDB_DIRECT_ALIGN)
+#define ALIGN_UP(x) ALIGN_DOWN((x) + LDB_DIRECT_ALIGN - 1)
+
+LDB_RES ldb_io_open (LDB_FILE *file, char *path, uint8_t create)
+{
+    struct stat st;
+    int flags = O_RDWR | O_DIRECT;
+    if(create)
+	flags |= O_CREAT | O_TRUNC;
+    file->fd = open(path, flags, 0644);
+    if(file->fd < 0)
+	return LDB_ERR;
+    if(fstat(file->fd, &st) ||
+       posix_memalign((void**)&file->buf, LDB_DIRECT_ALIGN, LDB_DIRECT_BUF))
+    {
+	close(file->fd);
+	return LDB_ERR;
+    }
+    file->pos = 0;
+    file->size = st.st_size;
+    return LDB_OK;
+}
+LDB_RES ldb_io_read (LDB_FILE *file, uint8_t *buf, uint32_t btr, uint32_t *br)
+{
+    uint32_t off, n, c;
+    ssize_t r;
+    //like fread, short read is error
+    if(file->pos > file->size || btr > file->size - file->pos)
+	return LDB_ERR;
+    *br = btr;
+    while(btr > 0) {
+	off = file->pos % LDB_DIRECT_ALIGN;
+	if(off == 0 && btr >= LDB_DIRECT_ALIGN &&
+	   (uintptr_t)buf % LDB_DIRECT_ALIGN == 0)
+	{
+	    //aligned blocks are read directly to caller's buffer
+	    c = ALIGN_DOWN(btr);
+	    r = pread(file->fd, buf, c, file->pos);
+	    if(r < (ssize_t)c)
+		return LDB_ERR;
+	}
+	else
+	{
+	    n = ALIGN_UP(off + btr);
+	    if(n > LDB_DIRECT_BUF)
+		n = LDB_DIRECT_BUF;
+	    c = n - off;
+	    if(c > btr)
+		c = btr;
+	    r = pread(file->fd, file->buf, n, file->pos - off);
+	    if(r < (ssize_t)(off + c))
+		return LDB_ERR;
+	    memcpy(buf, file->buf + off, c);
+	}
+	buf += c;
+	btr -= c;
+	file->pos += c;
+    }
+    return LDB_OK;
+}
+LDB_RES ldb_io_write (LDB_FILE *file, uint8_t *buf, uint32_t btw, uint32_t *bw)
+{
+    uint32_t off, n, c;
+    ssize_t r;
+    *bw = btw;
+    while(btw > 0) {
+	off = file->pos % LDB_DIRECT_ALIGN;
+	if(off == 0 && btw >= LDB_DIRECT_ALIGN &&
+	   (uintptr_t)buf % LDB_DIRECT_ALIGN == 0)
+	{
+	    c = ALIGN_DOWN(btw);
+	    if(pwrite(file->fd, buf, c, file->pos) != (ssize_t)c)
+		return LDB_ERR;
+	}
+	else
+	{
+	    n = ALIGN_UP(off + btw);
+	    if(n > LDB_DIRECT_BUF)
+		n = LDB_DIRECT_BUF;
+	    c = n - off;
+	    if(c > btw)
+		c = btw;
+	    //read blocks to keep data around written bytes
+	    r = 0;
+	    if(file->pos - off < file->size)
+		r = pread(file->fd, file->buf, n, file->pos - off);
+	    if(r < 0)
+		return LDB_ERR;
+	    memset(file->buf + r, 0, n - r);
+	    memcpy(file->buf + off, buf, c);
+	    if(pwrite(file->fd, file->buf, n, file->pos - off) != (ssize_t)n)
+		return LDB_ERR;
+	}
+	buf += c;
+	btw -= c;
+	file->pos += c;
+	if(file->pos > file->size)
+	    file->size = file->pos;
+    }
+    return LDB_OK;
+}
+LDB_RES ldb_io_lseek(LDB_FILE *file, uint32_t offset, int whence)
+{
+    switch(whence) {
+    case SEEK_SET: file->pos = offset; break;
+    case SEEK_CUR: file->pos += offset; break;
+    case SEEK_END: file->pos = file->size + offset; break;
+    default: return LDB_ERR;
+    }
+    return LDB_OK;
+}
+LDB_RES ldb_io_close(LDB_FILE *file)
+{
+    LDB_RES r = LDB_OK;
+    //cut padding of last block
+    if(ftruncate(file->fd, file->size) || close(file->fd))
+	r = LDB_ERR;
+    free(file->buf);
+    return r;
+}
+#if LDB_IO_READAHEAD
+LDB_RES ldb_io_readahead(LDB_FILE *file, uint32_t offset, uint32_t len)
+{
+    //there is no page cache to fill
+    (void)file;
+    (void)offset;
+    (void)len;
+    return LDB_OK;
+}
+#endif
@@ -0,0 +1,24 @@
+#ifndef LIGHDB_DIRECT_H
+#define LIGHDB_DIRECT_H
+
+//File for lighdb_direct.c. In lighdb_conf.h:
+//#include "lighdb_direct.h"
+//#define LDB_FILE ldb_direct_file
+
+#include <stdint.h>
+
+#ifndef LDB_DIRECT_ALIGN //block size for O_DIRECT
+#define LDB_DIRECT_ALIGN 4096
+#endif
+#ifndef LDB_DIRECT_BUF //size of aligned buffer of file for unaligned reads and writes
+#define LDB_DIRECT_BUF (64 * 1024)
+#endif
+
+typedef struct {
+    int fd;
+    uint32_t pos;  //current position
+    uint32_t size; //size of file. File on disk is rounded up to blocks till close
+    uint8_t *buf;  //LDB_DIRECT_BUF bytes aligned to LDB_DIRECT_ALIGN
+} ldb_direct_file;
+
+#endif
@@ -0,0 +1,32 @@
+#include "lighdb.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+//Mutexes for FreeRTOS. In lighdb_conf.h:
+//#define LDB_MUTEX 1
+//#define LDB_MUTEX_t SemaphoreHandle_t
+
+uint8_t ldb_mutex_create (LDB_MUTEX_t *sobj)
+{
+    *sobj = xSemaphoreCreateMutex();
+    if(*sobj == NULL)
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+uint8_t ldb_mutex_delete (LDB_MUTEX_t *sobj)
+{
+    vSemaphoreDelete(*sobj);
+    return LDB_OK;
+}
+uint8_t ldb_mutex_request_grant (LDB_MUTEX_t *sobj)
+{
+    if(xSemaphoreTake(*sobj, portMAX_DELAY) != pdTRUE)
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+uint8_t ldb_mutex_release_grant (LDB_MUTEX_t *sobj)
+{
+    if(xSemaphoreGive(*sobj) != pdTRUE)
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
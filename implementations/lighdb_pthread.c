@@ -0,0 +1,31 @@
+#include "lighdb.h"
+#include <pthread.h>
+
+//Mutexes for POSIX threads. In lighdb_conf.h:
+//#define LDB_MUTEX 1
+//#define LDB_MUTEX_t pthread_mutex_t
+
+uint8_t ldb_mutex_create (LDB_MUTEX_t *sobj)
+{
+    if(pthread_mutex_init(sobj, NULL))
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+uint8_t ldb_mutex_delete (LDB_MUTEX_t *sobj)
+{
+    if(pthread_mutex_destroy(sobj))
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+uint8_t ldb_mutex_request_grant (LDB_MUTEX_t *sobj)
+{
+    if(pthread_mutex_lock(sobj))
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+uint8_t ldb_mutex_release_grant (LDB_MUTEX_t *sobj)
+{
+    if(pthread_mutex_unlock(sobj))
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
@@ -0,0 +1,175 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L //for shm_open
+#endif
+#include "lighdb.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//DB shared by processes through POSIX shared memory. In lighdb_conf.h:
+//#define LDB_SHARED 1
+//#define LDB_MUTEX 1
+//#define LDB_MUTEX_t pthread_mutex_t
+//Use it with lighdb_pthread.c and IO which implements ldb_io_sync()
+
+//states of block
+#define SHM_READY 1   //DB is put to block
+#define SHM_REMOVED 2 //block was removed by last process, new one is needed
+
+//milliseconds of monotonic clock
+static uint64_t now_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+//process stops using block, last one removes it
+static LDB_RES shm_detach(LDB_SHARED_BLOCK *s, char *name)
+{
+    LDB_RES r = LDB_OK;
+    uint32_t size = sizeof(LDB_SHARED_BLOCK) + s->buffer_size * 4;
+    if(pthread_mutex_lock(&s->mutex))
+	r = LDB_ERR_MUTEX;
+    else
+    {
+	if(-- s->users == 0)
+	{
+	    //processes which opened it meanwhile see it and open new block
+	    __atomic_store_n(&s->ready, SHM_REMOVED, __ATOMIC_RELEASE);
+	    shm_unlink(name);
+	}
+	pthread_mutex_unlock(&s->mutex);
+    }
+    munmap(s, size);
+    return r;
+}
+LDB_RES ldb_shm_open(LighDB *db, char *name, uint32_t buffer_size)
+{
+    LDB_SHARED_BLOCK *s;
+    LDB_RES r;
+    struct stat st;
+    uint32_t size, ready;
+    uint8_t init;
+    uint64_t start = now_ms();
+    int fd;
+    for (;;) {
+	if(now_ms() - start > LDB_SHM_TIMEOUT)
+	    return LDB_ERR;
+	size = sizeof(LDB_SHARED_BLOCK) + buffer_size / 4 * 4;
+	init = 1;
+	//first process creates block
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fd < 0 && errno == EEXIST)
+	{
+	    init = 0;
+	    fd = shm_open(name, O_RDWR, 0600);
+	    //removed by last process just now
+	    if(fd < 0 && errno == ENOENT)
+		continue;
+	}
+	if(fd < 0)
+	    return LDB_ERR;
+	if(init && ftruncate(fd, size))
+	{
+	    close(fd);
+	    shm_unlink(name);
+	    return LDB_ERR;
+	}
+	if(!init)
+	{
+	    //wait till first process sets size of block
+	    do {
+		if(fstat(fd, &st) || now_ms() - start > LDB_SHM_TIMEOUT)
+		{
+		    close(fd);
+		    return LDB_ERR;
+		}
+		if(st.st_size < (off_t)sizeof(LDB_SHARED_BLOCK))
+		    sched_yield();
+	    } while(st.st_size < (off_t)sizeof(LDB_SHARED_BLOCK));
+	    size = st.st_size;
+	}
+	s = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(s == MAP_FAILED)
+	{
+	    if(init)
+		shm_unlink(name);
+	    return LDB_ERR;
+	}
+	if(init)
+	{
+	    pthread_mutexattr_t a;
+	    if(pthread_mutexattr_init(&a) ||
+	       pthread_mutexattr_setpshared(&a, PTHREAD_PROCESS_SHARED) ||
+	       pthread_mutex_init(&s->mutex, &a))
+	    {
+		munmap(s, size);
+		shm_unlink(name);
+		return LDB_ERR;
+	    }
+	    pthread_mutexattr_destroy(&a);
+	    s->buffer_size = buffer_size / 4;
+	    s->users = 1;
+	    r = ldb_share(db, s, 1);
+	    if(r)
+	    {
+		shm_unlink(name);
+		__atomic_store_n(&s->ready, SHM_REMOVED, __ATOMIC_RELEASE);
+		munmap(s, size);
+		return r;
+	    }
+	    //other processes wait for it
+	    __atomic_store_n(&s->ready, SHM_READY, __ATOMIC_RELEASE);
+	    return LDB_OK;
+	}
+	//wait till first process puts DB to block. If it crashed then block is never ready
+	while((ready = __atomic_load_n(&s->ready, __ATOMIC_ACQUIRE)) == 0 &&
+	      now_ms() - start <= LDB_SHM_TIMEOUT)
+	    sched_yield();
+	if(ready == SHM_READY)
+	{
+	    if(pthread_mutex_lock(&s->mutex))
+	    {
+		munmap(s, size);
+		return LDB_ERR_MUTEX;
+	    }
+	    //last process can remove it before mutex is taken
+	    ready = s->ready;
+	    if(ready == SHM_READY)
+		s->users ++;
+	    pthread_mutex_unlock(&s->mutex);
+	}
+	if(ready == SHM_READY)
+	    break;
+	munmap(s, size);
+	if(ready == 0)
+	    return LDB_ERR;
+    }
+    r = ldb_share(db, s, 0);
+    if(r)
+	shm_detach(s, name);
+    return r;
+}
+LDB_RES ldb_shm_close(LighDB *db, char *name)
+{
+    if(db == 0 || name == 0 || db->shared == 0)
+	return LDB_ERR_ZERO_POINTER;
+    LDB_SHARED_BLOCK *s = db->shared;
+    LDB_RES r = ldb_close(db);
+    LDB_RES rd = shm_detach(s, name);
+    return r ? r : rd;
+}
+LDB_RES ldb_shm_unlink(char *name)
+{
+    if(name == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(shm_unlink(name))
+	return LDB_ERR;
+    return LDB_OK;
+}
@@ -1,3 +1,6 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L //for posix_fadvise
+#endif
 #include "lighdb.h"
 #include <stdio.h>
 #include <unistd.h>
@@ -12,6 +15,11 @@ LDB_RES ldb_io_open (LDB_FILE *file, char *path, uint8_t create)
     
     if(*file == NULL)
 	return LDB_ERR;
+#if LDB_SHARED
+    //fflush() doesn't drop read data, which was used up, and fseek() inside it
+    //doesn't read file again. So stream of file changed by other processes isn't buffered
+    setvbuf(*file, NULL, _IONBF, 0);
+#endif
     return LDB_OK;
 }
 LDB_RES ldb_io_read (LDB_FILE *file, uint8_t *buf, uint32_t btr, uint32_t *br)
@@ -43,3 +51,21 @@ LDB_RES ldb_io_close(LDB_FILE *file)
 	return LDB_ERR;
     return LDB_OK;
 }
+#if LDB_IO_READAHEAD
+LDB_RES ldb_io_readahead(LDB_FILE *file, uint32_t offset, uint32_t len)
+{
+    //kernel reads pages to cache in background
+    if(posix_fadvise(fileno(*file), offset, len, POSIX_FADV_WILLNEED))
+	return LDB_ERR;
+    return LDB_OK;
+}
+#endif
+#if LDB_SHARED
+LDB_RES ldb_io_sync(LDB_FILE *file)
+{
+    //writes buffered data. Stream isn't buffered, see ldb_io_open()
+    if(fflush(*file) == EOF)
+	return LDB_ERR;
+    return LDB_OK;
+}
+#endif
@@ -1,78 +1,851 @@
 #include "lighdb.h"
+#include <string.h>
 
 static char ldb_ver[] = "LighDB"LIGHDB_VERSION;
+static char ldb_ver_v1[] = "LighDB001"; //version of DB without format flags
+static char ldb_env_ver[] = "LighEnv01";
+#if LDB_SUMMARY
+static char ldb_sum_ver[] = "LighSum01";
+#endif
+#define LDB_SYSHEADER_V1 22 //size of system header of version 001
+
+#if LDB_IO_READAHEAD
+#define LDB_READAHEAD(file, offset, len) ldb_io_readahead(file, offset, len)
+#else
+#define LDB_READAHEAD(file, offset, len) do {} while(0)
+#endif
+
+#if LDB_CRC
+#define LDB_F_SUPPORTED_CRC LDB_F_CRC
+#else
+#define LDB_F_SUPPORTED_CRC 0
+#endif
+#if LDB_PAX
+#define LDB_F_SUPPORTED_PAX LDB_F_PAX
+#else
+#define LDB_F_SUPPORTED_PAX 0
+#endif
+#if LDB_ID_PACK
+#define LDB_F_SUPPORTED_PACK LDB_F_PACKED_IDS
+#else
+#define LDB_F_SUPPORTED_PACK 0
+#endif
+#define LDB_F_SUPPORTED (LDB_F_SUPPORTED_CRC | LDB_F_ALIGNED | \
+			 LDB_F_ALIGN_ROWS | LDB_F_SORTED | LDB_F_SUPPORTED_PAX | \
+			 LDB_F_SUPPORTED_PACK)
+
+#if LDB_CRC
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#else
+//CRC32C (Castagnoli) table for reflected polynomial 0x82F63B78
+static const uint32_t crc32c_table[256] = {
+    0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+    0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+    0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+    0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+    0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+    0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+    0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+    0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+    0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+    0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+    0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+    0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+    0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+    0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+    0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+    0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+    0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+    0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+    0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+    0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+    0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+    0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+    0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+    0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+    0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+    0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+    0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+    0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+    0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+    0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+    0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+    0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+    0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+    0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+    0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+    0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+    0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+    0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+    0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+    0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+    0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+    0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+    0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
+};
+#endif
+//CRC32C of buffer. crc is CRC32C of previous data or 0 at start
+static uint32_t crc32c(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+#if defined(__SSE4_2__)
+#if defined(__x86_64__)
+    uint64_t c = crc, v;
+    for (; len >= 8; len -= 8, buf += 8) {
+	memcpy(&v, buf, 8);
+	c = _mm_crc32_u64(c, v);
+    }
+    crc = (uint32_t)c;
+#endif
+    for (; len > 0; len--)
+	crc = _mm_crc32_u8(crc, *buf++);
+#elif defined(__ARM_FEATURE_CRC32)
+    uint64_t v;
+    for (; len >= 8; len -= 8, buf += 8) {
+	memcpy(&v, buf, 8);
+	crc = __crc32cd(crc, v);
+    }
+    for (; len > 0; len--)
+	crc = __crc32cb(crc, *buf++);
+#else
+    for (; len > 0; len--)
+	crc = crc32c_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+#endif
+    return ~crc;
+}
+#endif
+
+//size of system header in index file
+static uint32_t sysheader_size(LighDB *db)
+{
+    if(memcmp(db->h.version, ldb_ver_v1, 9) == 0)
+	return LDB_SYSHEADER_V1;
+    return sizeof(db->h);
+}
+//use DB's own files and mutex
+static void own_files(LighDB *db)
+{
+    db->pfile_data = &db->file_data;
+    db->pfile_index = &db->file_index;
+    db->pmutex = &db->mutex;
+    db->env = 0;
+    db->index_base = 0;
+    db->capacity = 0;
+#if LDB_SHARED
+    db->shared = 0;
+#endif
+}
+#if LDB_SHARED
+//take mutex and get state of DB from shared block
+static LDB_RES db_lock(LighDB *db)
+{
+    if(LDB_MUTEX_REQUEST(db->pmutex))
+	return LDB_ERR_MUTEX;
+    LDB_SHARED_BLOCK *s = db->shared;
+    if(s != 0)
+    {
+	db->h.count = s->count;
+	db->h.flags = s->flags;
+	db->last_id = s->last_id;
+#if LDB_ID_PACK
+	db->pack_dir = s->pack_dir;
+	db->pack_size = s->pack_size;
+#endif
+	db->buffer_id_start_index = s->buffer_start;
+	db->buffer_id_count = s->buffer_count;
+    }
+    return LDB_OK;
+}
+//put state of DB to shared block and release mutex
+static LDB_RES db_unlock(LighDB *db)
+{
+    LDB_SHARED_BLOCK *s = db->shared;
+    if(s != 0)
+    {
+	s->count = db->h.count;
+	s->flags = db->h.flags;
+	s->last_id = db->last_id;
+#if LDB_ID_PACK
+	s->pack_dir = db->pack_dir;
+	s->pack_size = db->pack_size;
+#endif
+	s->buffer_start = db->buffer_id_start_index;
+	s->buffer_count = db->buffer_id_count;
+	//other processes must see written data and not cached one
+	if(db->opened)
+	{
+	    ldb_io_sync(db->pfile_index);
+	    ldb_io_sync(db->pfile_data);
+	}
+    }
+    if(LDB_MUTEX_RELEASE(db->pmutex))
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+#else
+#define db_lock(db) LDB_MUTEX_REQUEST((db)->pmutex)
+#define db_unlock(db) LDB_MUTEX_RELEASE((db)->pmutex)
+#endif
+//size of item with its checksum
+static uint32_t row_size(LighDB *db)
+{
+    return db->h.item_size + ((db->h.flags & LDB_F_CRC) ? 4 : 0);
+}
+//distance between items in data file
+static uint32_t item_stride(LighDB *db)
+{
+    uint32_t s = row_size(db), p = 1;
+    if((db->h.flags & LDB_F_ALIGN_ROWS) == 0)
+	return s;
+    //row doesn't cross page: power of 2 inside page or whole pages
+    if(s >= LDB_ALIGN)
+	return (s + LDB_ALIGN - 1) / LDB_ALIGN * LDB_ALIGN;
+    while(p < s)
+	p <<= 1;
+    return p;
+}
+//round offset up to page with LDB_F_ALIGNED
+static uint32_t align_up(LighDB *db, uint32_t offset)
+{
+    if(db->h.flags & LDB_F_ALIGNED)
+	return (offset + LDB_ALIGN - 1) / LDB_ALIGN * LDB_ALIGN;
+    return offset;
+}
+#if LDB_ID_PACK
+//Header of packed block of ID table
+typedef struct __attribute__((packed)) {
+    uint32_t min;  //smallest ID in block
+    uint32_t max;  //biggest ID in block
+    uint32_t off;  //offset of values from the beginning of packed values
+    uint8_t bits;  //bits of every value
+    uint8_t delta; //1 if values are differences with previous ID, 0 if with min
+} LDB_ID_BLOCK;
+
+//offset of packed values, they are after directory of block headers
+static uint32_t pack_values(LighDB *db)
+{
+    return db->index_offset + 8 + db->pack_dir * sizeof(LDB_ID_BLOCK);
+}
+#endif
+//offset of item's ID in index file
+static uint32_t id_offset(LighDB *db, uint32_t index)
+{
+#if LDB_ID_PACK
+    //only IDs after packed blocks have offsets
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return pack_values(db) + db->pack_size + (index % LDB_PACK_IDS) * 4;
+#endif
+    if(db->h.flags & LDB_F_CRC)
+	return db->index_offset +
+	    (index / LDB_CRC_PAGE_IDS) * (LDB_CRC_PAGE_IDS + 1) * 4 +
+	    (index % LDB_CRC_PAGE_IDS) * 4;
+    return db->index_offset + index * 4;
+}
+//how many IDs can be loaded to buffer
+static uint32_t buf_ids_size(LighDB *db)
+{
+    //only whole pages with checksums fit in buffer
+    if(db->h.flags & LDB_F_CRC)
+	return db->buffer_id_size / (LDB_CRC_PAGE_IDS + 1) * LDB_CRC_PAGE_IDS;
+#if LDB_ID_PACK
+    //buffer has one block, so blocks without ID aren't read
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return db->buffer_id_size >= LDB_PACK_IDS ? LDB_PACK_IDS : 0;
+#endif
+    return db->buffer_id_size;
+}
+//smallest size of buffer in IDs, which fits one page of ID table
+static uint32_t min_buf_size(LighDB *db)
+{
+    if(db->h.flags & LDB_F_CRC)
+	return LDB_CRC_PAGE_IDS + 1;
+#if LDB_ID_PACK
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return LDB_PACK_IDS;
+#endif
+    return LDB_MIN_ID_BUFF;
+}
+#if LDB_ID_PACK
+//read header of packed block b from directory
+static LDB_RES pack_header(LighDB *db, uint32_t b, LDB_ID_BLOCK *h)
+{
+    uint32_t br;
+    if(ldb_io_lseek(db->pfile_index,
+		    db->index_offset + 8 + b * sizeof(*h), SEEK_SET) ||
+       ldb_io_read(db->pfile_index, (uint8_t*)h, sizeof(*h), &br) ||
+       br != sizeof(*h))
+	return LDB_ERR_IO;
+    if(h->bits > 32)
+	return LDB_ERR_HEADER;
+    return LDB_OK;
+}
+//unpack values of block in place. Packed values are at the end of LDB_PACK_IDS IDs,
+//so value is read before its place is overwritten
+static void unpack_ids(uint32_t *v, LDB_ID_BLOCK *h)
+{
+    uint32_t i, pos, prev = h->min;
+    uint32_t *in = v + LDB_PACK_IDS - h->bits * LDB_PACK_IDS / 32;
+    uint32_t mask = (h->bits == 32) ? 0xFFFFFFFF : ((uint32_t)1 << h->bits) - 1;
+    uint64_t x;
+    if(h->bits == 0)
+	memset(v, 0, LDB_PACK_IDS * 4);
+    else
+	for (i = 0; i < LDB_PACK_IDS; i++) {
+	    pos = i * h->bits;
+	    x = in[pos / 32];
+	    if(pos % 32 + h->bits > 32)
+		x |= (uint64_t)in[pos / 32 + 1] << 32;
+	    v[i] = (uint32_t)(x >> (pos % 32)) & mask;
+	}
+    if(h->delta)
+	for (i = 0; i < LDB_PACK_IDS; i++) {
+	    prev += v[i];
+	    v[i] = prev;
+	}
+    else
+	for (i = 0; i < LDB_PACK_IDS; i++)
+	    v[i] += h->min;
+}
+#endif
+//offset of first item in data file, before alignment
+static uint32_t data_start(LighDB *db)
+{
+#if LDB_PAX
+    //table of fields is after version
+    if(db->h.flags & LDB_F_PAX)
+	return 10 + 8 + db->pax_fields * sizeof(LDB_FIELD);
+#else
+    (void)db;
+#endif
+    return 10;
+}
+#if LDB_PAX
+//fields must follow each other and cover whole item
+static LDB_RES pax_check(LDB_FIELD *fields, uint32_t count, uint32_t size)
+{
+    uint32_t i, end = 0;
+    if(count == 0 || count > LDB_PAX_FIELDS)
+	return LDB_ERR;
+    for (i = 0; i < count; i++) {
+	if(fields[i].offset != end || fields[i].len == 0)
+	    return LDB_ERR;
+	end += fields[i].len;
+    }
+    return end == size ? LDB_OK : LDB_ERR;
+}
+//read table of fields after version of data file
+static LDB_RES pax_read_fields(LighDB *db)
+{
+    uint32_t hdr[2], br;
+    if(ldb_io_lseek(db->pfile_data, 10, SEEK_SET) ||
+       ldb_io_read(db->pfile_data, (uint8_t*)hdr, 8, &br) || br != 8)
+	return LDB_ERR_IO;
+    if(hdr[0] == 0 || hdr[1] == 0 || hdr[1] > LDB_PAX_FIELDS)
+	return LDB_ERR_HEADER;
+    db->pax_block = hdr[0];
+    db->pax_fields = hdr[1];
+    if(ldb_io_read(db->pfile_data, (uint8_t*)db->pax,
+		   db->pax_fields * sizeof(LDB_FIELD), &br) ||
+       br != db->pax_fields * sizeof(LDB_FIELD))
+	return LDB_ERR_IO;
+    if(pax_check(db->pax, db->pax_fields, db->h.item_size))
+	return LDB_ERR_HEADER;
+    return LDB_OK;
+}
+//biggest field. Fields of items are collected in buffer of this size per item
+static uint32_t pax_max_len(LighDB *db)
+{
+    uint32_t i, m = 0;
+    for (i = 0; i < db->pax_fields; i++)
+	if(db->pax[i].len > m)
+	    m = db->pax[i].len;
+    return m;
+}
+//field which contains bytes [offset; offset + len) of item, or 0
+static LDB_FIELD *pax_field(LighDB *db, uint32_t offset, uint32_t len)
+{
+    uint32_t i;
+    if((db->h.flags & LDB_F_PAX) == 0)
+	return 0;
+    for (i = 0; i < db->pax_fields; i++)
+	if(offset >= db->pax[i].offset &&
+	   offset + len <= db->pax[i].offset + db->pax[i].len)
+	    return &db->pax[i];
+    return 0;
+}
+//offset of field of item in data file
+static uint32_t pax_offset(LighDB *db, LDB_FIELD *f, uint32_t index)
+{
+    uint32_t b = db->pax_block;
+    return db->data_offset + index / b * b * db->h.item_size +
+	b * f->offset + index % b * f->len;
+}
+//read field of n items from index from. Values are put one by one
+static LDB_RES pax_read_field(LighDB *db, LDB_FIELD *f,
+			      uint32_t from, uint32_t n, uint8_t *buf)
+{
+    uint32_t k, br;
+    while(n != 0) {
+	//values are one by one till end of block
+	k = db->pax_block - from % db->pax_block;
+	if(k > n)
+	    k = n;
+	if(ldb_io_lseek(db->pfile_data, pax_offset(db, f, from), SEEK_SET) ||
+	   ldb_io_read(db->pfile_data, buf, k * f->len, &br) ||
+	   br != k * f->len)
+	    return LDB_ERR_IO;
+	buf += k * f->len;
+	from += k;
+	n -= k;
+    }
+    return LDB_OK;
+}
+//read n items from index from. Every field is read to tmp and put to items,
+//so tmp must have room for n values of biggest field
+static LDB_RES pax_read_items(LighDB *db, uint32_t from, uint32_t n,
+			      uint8_t *items, uint8_t *tmp)
+{
+    LDB_RES r;
+    uint32_t j;
+    LDB_FIELD *f;
+    for (f = db->pax; f < db->pax + db->pax_fields; f++) {
+	if((r = pax_read_field(db, f, from, n, tmp)))
+	    return r;
+	for (j = 0; j < n; j++)
+	    memcpy(items + j * db->h.item_size + f->offset,
+		   tmp + j * f->len, f->len);
+    }
+    return LDB_OK;
+}
+#endif
+//how many items read_items() can read to buffer
+static uint32_t chunk_items(LighDB *db)
+{
+#if LDB_PAX
+    if(db->h.flags & LDB_F_PAX)
+	return db->buffer_id_size * 4 / (db->h.item_size + pax_max_len(db));
+#endif
+    return db->buffer_id_size * 4 / item_stride(db);
+}
+//read ID of last item. ldb_add() compares new ID with it to keep LDB_F_SORTED
+static LDB_RES read_last_id(LighDB *db)
+{
+    uint32_t br;
+    db->last_id = 0;
+    if(db->h.count == 0 || (db->h.flags & LDB_F_SORTED) == 0)
+	return LDB_OK;
+#if LDB_ID_PACK
+    //last ID of sorted packed block is its max
+    if((db->h.flags & LDB_F_PACKED_IDS) && db->h.count % LDB_PACK_IDS == 0)
+    {
+	LDB_ID_BLOCK h;
+	LDB_RES r;
+	if((r = pack_header(db, db->h.count / LDB_PACK_IDS - 1, &h)))
+	    return r;
+	db->last_id = h.max;
+	return LDB_OK;
+    }
+#endif
+    if(ldb_io_lseek(db->pfile_index, id_offset(db, db->h.count - 1),
+		    SEEK_SET) ||
+       ldb_io_read(db->pfile_index, (uint8_t*)&db->last_id, 4, &br) ||
+       br != 4)
+	return LDB_ERR_IO;
+    return LDB_OK;
+}
+//read item and check its checksum
+static LDB_RES read_item(LighDB *db, uint32_t index, uint8_t *buf)
+{
+    uint32_t br;
+    if(index >= db->h.count)
+	return LDB_BIG_INDEX;
+#if LDB_PAX
+    if(db->h.flags & LDB_F_PAX)
+    {
+	LDB_RES r;
+	LDB_FIELD *f;
+	for (f = db->pax; f < db->pax + db->pax_fields; f++)
+	    if((r = pax_read_field(db, f, index, 1, buf + f->offset)))
+		return r;
+	return LDB_OK;
+    }
+#endif
+    if(ldb_io_lseek(db->pfile_data,
+		    db->data_offset + item_stride(db) * index,
+		    SEEK_SET) ||
+       ldb_io_read(db->pfile_data, buf, db->h.item_size, &br) ||
+       br != db->h.item_size)
+	return LDB_ERR_IO;
+#if LDB_CRC
+    if(db->h.flags & LDB_F_CRC)
+    {
+	uint32_t crc;
+	if(ldb_io_read(db->pfile_data, (uint8_t*)&crc, 4, &br) || br != 4)
+	    return LDB_ERR_IO;
+	if(crc != crc32c(0, buf, db->h.item_size))
+	    return LDB_ERR_CRC;
+    }
+#endif
+    return LDB_OK;
+}
+//read n items from index from to buffer and check their checksums.
+//bad returns index of first damaged item
+static LDB_RES read_items(LighDB *db, uint32_t from, uint32_t n,
+			  uint32_t *bad)
+{
+    uint32_t br, stride = item_stride(db);
+    uint8_t *items = (uint8_t*)db->buffer_id;
+    //padding after last row can be absent in file
+    uint32_t len = (n - 1) * stride + row_size(db);
+    //buffer is overwritten, so ID table in it is not valid anymore
+    db->buffer_id_count = 0;
+#if !LDB_CRC
+    (void)bad;
+#endif
+#if LDB_PAX
+    if(db->h.flags & LDB_F_PAX)
+	return pax_read_items(db, from, n, items,
+			      items + n * db->h.item_size);
+#endif
+    if(ldb_io_lseek(db->pfile_data,
+		    db->data_offset + stride * from,
+		    SEEK_SET) ||
+       ldb_io_read(db->pfile_data, items, len, &br) ||
+       br != len)
+	return LDB_ERR_IO;
+    //next chunk is read while this one is processed
+    if(from + n < db->h.count)
+	LDB_READAHEAD(db->pfile_data,
+		      db->data_offset + stride * (from + n),
+		      n * stride);
+#if LDB_CRC
+    if(db->h.flags & LDB_F_CRC)
+    {
+	uint32_t i, crc;
+	for (i = 0; i < n; i++) {
+	    memcpy(&crc, items + i * stride + db->h.item_size, 4);
+	    if(crc != crc32c(0, items + i * stride, db->h.item_size))
+	    {
+		if(bad != 0)
+		    *bad = from + i;
+		return LDB_ERR_CRC;
+	    }
+	}
+    }
+#endif
+    return LDB_OK;
+}
+#if !LDB_READ_ONLY
+//write item and its checksum
+static LDB_RES write_item(LighDB *db, uint32_t index, uint8_t *data)
+{
+    uint32_t bw;
+#if LDB_PAX
+    if(db->h.flags & LDB_F_PAX)
+    {
+	LDB_FIELD *f;
+	for (f = db->pax; f < db->pax + db->pax_fields; f++)
+	    if(ldb_io_lseek(db->pfile_data, pax_offset(db, f, index),
+			    SEEK_SET) ||
+	       ldb_io_write(db->pfile_data, data + f->offset, f->len, &bw))
+		return LDB_ERR_IO;
+	return LDB_OK;
+    }
+#endif
+    if(ldb_io_lseek(db->pfile_data,
+		    db->data_offset + item_stride(db) * index,
+		    SEEK_SET) ||
+       ldb_io_write(db->pfile_data, data, db->h.item_size, &bw))
+	return LDB_ERR_IO;
+#if LDB_CRC
+    if(db->h.flags & LDB_F_CRC)
+    {
+	uint32_t crc = crc32c(0, data, db->h.item_size);
+	if(ldb_io_write(db->pfile_data, (uint8_t*)&crc, 4, &bw))
+	    return LDB_ERR_IO;
+    }
+#endif
+    return LDB_OK;
+}
+#if LDB_ID_PACK
+//pack LDB_PACK_IDS IDs of v in place and fill header. Values are packed forward,
+//so packed word never overwrites ID which isn't read yet.
+//Returns size of packed values in bytes
+static uint32_t pack_ids(uint32_t *v, LDB_ID_BLOCK *h)
+{
+    uint32_t i, x, prev, maxd = 0, n = 0, w = 0;
+    uint8_t sorted = 1, bits = 0;
+    uint64_t acc = 0;
+    h->min = h->max = v[0];
+    for (i = 1; i < LDB_PACK_IDS; i++) {
+	if(v[i] < h->min)
+	    h->min = v[i];
+	if(v[i] > h->max)
+	    h->max = v[i];
+	if(v[i] < v[i - 1])
+	    sorted = 0;
+	else if(v[i] - v[i - 1] > maxd)
+	    maxd = v[i] - v[i - 1];
+    }
+    //differences of ascending IDs can be smaller than their range
+    h->delta = sorted && maxd < h->max - h->min;
+    x = h->delta ? maxd : h->max - h->min;
+    while(bits < 32 && (x >> bits) != 0)
+	bits ++;
+    h->bits = bits;
+    prev = h->min;
+    for (i = 0; i < LDB_PACK_IDS && bits != 0; i++) {
+	x = h->delta ? v[i] - prev : v[i] - h->min;
+	prev = v[i];
+	acc |= (uint64_t)x << n;
+	n += bits;
+	if(n >= 32)
+	{
+	    v[w++] = (uint32_t)acc;
+	    acc >>= 32;
+	    n -= 32;
+	}
+    }
+    return bits * LDB_PACK_IDS / 8;
+}
+//write size of directory and size of packed values, they are before directory
+static LDB_RES pack_sizes(LighDB *db)
+{
+    uint32_t v[2] = {db->pack_dir, db->pack_size}, bw;
+    if(ldb_io_lseek(db->pfile_index, db->index_offset, SEEK_SET) ||
+       ldb_io_write(db->pfile_index, (uint8_t*)v, 8, &bw) ||
+       bw != 8)
+	return LDB_ERR_IO;
+    return LDB_OK;
+}
+//double directory of block headers. len bytes of packed values and last IDs
+//are moved after it by pieces of buffer size, from the end
+static LDB_RES pack_grow(LighDB *db, uint32_t len)
+{
+    uint32_t n, br, bw, from = pack_values(db);
+    uint32_t shift = db->pack_dir * sizeof(LDB_ID_BLOCK);
+    uint32_t piece = db->buffer_id_size * 4;
+    uint8_t *buf = (uint8_t*)db->buffer_id;
+    db->buffer_id_count = 0;
+    while(len != 0) {
+	n = len < piece ? len : piece;
+	len -= n;
+	if(ldb_io_lseek(db->pfile_index, from + len, SEEK_SET) ||
+	   ldb_io_read(db->pfile_index, buf, n, &br) ||
+	   br != n ||
+	   ldb_io_lseek(db->pfile_index, from + len + shift, SEEK_SET) ||
+	   ldb_io_write(db->pfile_index, buf, n, &bw) ||
+	   bw != n)
+	    return LDB_ERR_IO;
+    }
+    db->pack_dir *= 2;
+    return pack_sizes(db);
+}
+//write ID of new item after packed values. Last ID of block packs the block.
+//Buffer must fit block
+static LDB_RES pack_append(LighDB *db, uint32_t index, uint32_t id)
+{
+    LDB_RES r;
+    uint32_t bw, size, n = index % LDB_PACK_IDS, *v = db->buffer_id;
+    uint32_t b = index / LDB_PACK_IDS;
+    LDB_ID_BLOCK h;
+    if(n != LDB_PACK_IDS - 1)
+    {
+	if(ldb_io_lseek(db->pfile_index, id_offset(db, index), SEEK_SET) ||
+	   ldb_io_write(db->pfile_index, (uint8_t*)&id, 4, &bw))
+	    return LDB_ERR_IO;
+	return LDB_OK;
+    }
+    //directory must have room for header of block
+    if(b == db->pack_dir && (r = pack_grow(db, db->pack_size + n * 4)))
+	return r;
+    //block is collected in buffer
+    db->buffer_id_count = 0;
+    if(ldb_io_lseek(db->pfile_index, id_offset(db, index - n), SEEK_SET) ||
+       ldb_io_read(db->pfile_index, (uint8_t*)v, n * 4, &bw) ||
+       bw != n * 4)
+	return LDB_ERR_IO;
+    v[n] = id;
+    size = pack_ids(v, &h);
+    h.off = db->pack_size;
+    if((size != 0 &&
+	(ldb_io_lseek(db->pfile_index, pack_values(db) + h.off, SEEK_SET) ||
+	 ldb_io_write(db->pfile_index, (uint8_t*)v, size, &bw))) ||
+       ldb_io_lseek(db->pfile_index,
+		    db->index_offset + 8 + b * sizeof(h), SEEK_SET) ||
+       ldb_io_write(db->pfile_index, (uint8_t*)&h, sizeof(h), &bw))
+	return LDB_ERR_IO;
+    db->pack_size += size;
+    return pack_sizes(db);
+}
+#endif
+//write ID of new item at the end of ID table and update checksum of its page
+static LDB_RES append_id(LighDB *db, uint32_t index, uint32_t id)
+{
+    uint32_t bw;
+#if LDB_ID_PACK
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return pack_append(db, index, id);
+#endif
+    if(ldb_io_lseek(db->pfile_index, id_offset(db, index), SEEK_SET) ||
+       ldb_io_write(db->pfile_index, (uint8_t*)&id, 4, &bw))
+	return LDB_ERR_IO;
+#if LDB_CRC
+    if(db->h.flags & LDB_F_CRC)
+    {
+	//checksum of page is continued from checksum of previous IDs in it
+	uint32_t crc = 0, br;
+	uint32_t pos = id_offset(db, index - index % LDB_CRC_PAGE_IDS) +
+	    LDB_CRC_PAGE_IDS * 4;
+	if(index % LDB_CRC_PAGE_IDS != 0 &&
+	   (ldb_io_lseek(db->pfile_index, pos, SEEK_SET) ||
+	    ldb_io_read(db->pfile_index, (uint8_t*)&crc, 4, &br) ||
+	    br != 4))
+	    return LDB_ERR_IO;
+	crc = crc32c(crc, (uint8_t*)&id, 4);
+	if(ldb_io_lseek(db->pfile_index, pos, SEEK_SET) ||
+	   ldb_io_write(db->pfile_index, (uint8_t*)&crc, 4, &bw))
+	    return LDB_ERR_IO;
+    }
+#endif
+    return LDB_OK;
+}
+#endif
+
 
 LDB_RES ldb_open(LighDB *db,
 		 char *path_index, char *path_data)
 {
     if(db == 0 || path_index == 0 || path_data == 0)
 	return LDB_ERR_ZERO_POINTER;
+    own_files(db);
 
     //open index file
-    if(ldb_io_open(&db->file_index, path_index, 0)) {
+    if(ldb_io_open(db->pfile_index, path_index, 0)) {
 	return LDB_ERR_IO;
     }
     //set db opened
     db->opened    = 1;
     
     uint32_t br;
-    //read header
-    if(ldb_io_read(&db->file_index,
-		   (uint8_t*)&db->h, sizeof(db->h), &br)) {
-	ldb_io_close(&db->file_index);
+    //read header of version 001
+    if(ldb_io_read(db->pfile_index,
+		   (uint8_t*)&db->h, LDB_SYSHEADER_V1, &br)) {
+	ldb_io_close(db->pfile_index);
 	return LDB_ERR_IO;
     }
     //check header size
-    if(sizeof(db->h) != br) {
-	ldb_io_close(&db->file_index);
+    if(LDB_SYSHEADER_V1 != br) {
+	ldb_io_close(db->pfile_index);
 	return LDB_ERR_IO;
     }
     //check is it LighDB
     for (uint8_t i = 0; i < 6; i++)
 	if(db->h.version[i] != ldb_ver[i])
 	{
-	    ldb_io_close(&db->file_index);
+	    ldb_io_close(db->pfile_index);
 	    return LDB_ERR_HEADER;
 	}
+    //read rest of header of newer versions
+    db->h.flags = 0;
+    if(sysheader_size(db) > LDB_SYSHEADER_V1 &&
+       (ldb_io_read(db->pfile_index,
+		    (uint8_t*)&db->h + LDB_SYSHEADER_V1,
+		    sysheader_size(db) - LDB_SYSHEADER_V1, &br) ||
+	br != sysheader_size(db) - LDB_SYSHEADER_V1)) {
+	ldb_io_close(db->pfile_index);
+	return LDB_ERR_IO;
+    }
+    //check that format is supported
+    if(db->h.flags & ~LDB_F_SUPPORTED) {
+	ldb_io_close(db->pfile_index);
+	return LDB_ERR_HEADER;
+    }
     //calculate index table offset
-    db->index_offset = sizeof(db->h) + db->h.header_size;
+    db->index_offset = align_up(db, sysheader_size(db) + db->h.header_size);
+#if LDB_ID_PACK
+    //sizes of directory and packed values are before them
+    db->pack_dir = 0;
+    db->pack_size = 0;
+    if(db->h.flags & LDB_F_PACKED_IDS)
+    {
+	uint32_t v[2];
+	if(ldb_io_lseek(db->pfile_index, db->index_offset, SEEK_SET) ||
+	   ldb_io_read(db->pfile_index, (uint8_t*)v, 8, &br) ||
+	   br != 8) {
+	    ldb_io_close(db->pfile_index);
+	    return LDB_ERR_IO;
+	}
+	db->pack_dir = v[0];
+	db->pack_size = v[1];
+	//every block has header in directory
+	if(db->pack_dir == 0 || db->pack_dir < db->h.count / LDB_PACK_IDS) {
+	    ldb_io_close(db->pfile_index);
+	    return LDB_ERR_HEADER;
+	}
+    }
+#endif
     //open data file
-    if(ldb_io_open(&db->file_data, path_data, 0)) {
-	ldb_io_close(&db->file_data);
+    if(ldb_io_open(db->pfile_data, path_data, 0)) {
+	ldb_io_close(db->pfile_data);
 	return LDB_ERR_IO;
     }
 
     uint8_t buf[10];
     //read first 10 bytes in data file
-    if(ldb_io_read(&db->file_data,
+    if(ldb_io_read(db->pfile_data,
 		   buf, 10, &br)) {
-	ldb_io_close(&db->file_index);
-	ldb_io_close(&db->file_data);
+	ldb_io_close(db->pfile_index);
+	ldb_io_close(db->pfile_data);
 	return LDB_ERR_IO;
     }
     //check count
     if(10 != br) {
-	ldb_io_close(&db->file_index);
-	ldb_io_close(&db->file_data);
+	ldb_io_close(db->pfile_index);
+	ldb_io_close(db->pfile_data);
 	return LDB_ERR_IO;
     }
     //check is it LighDB
     for (uint8_t i = 0; i < 6; i++)
 	if(buf[i] != ldb_ver[i])
 	{
-	    ldb_io_close(&db->file_index);
-	    ldb_io_close(&db->file_data);
+	    ldb_io_close(db->pfile_index);
+	    ldb_io_close(db->pfile_data);
 	    return LDB_ERR_HEADER;
 	}
 
     printf("%s %ld it sz %d, count %d\n", db->h.version, sizeof(db->h), db->h.item_size, db->h.count);
     
-    db->data_offset = 10;
+#if LDB_PAX
+    LDB_RES r;
+    if((db->h.flags & LDB_F_PAX) && (r = pax_read_fields(db))) {
+	ldb_io_close(db->pfile_index);
+	ldb_io_close(db->pfile_data);
+	return r;
+    }
+#endif
+    db->data_offset = align_up(db, data_start(db));
+    if(read_last_id(db)) {
+	ldb_io_close(db->pfile_index);
+	ldb_io_close(db->pfile_data);
+	return LDB_ERR_IO;
+    }
     //clear buffer pointers
     db->buffer_id = 0;
     db->buffer_id_size = 0;
+    db->buffer_id_count = 0;
+    db->snapshots = 0;
+#if LDB_CHANGELOG
+    db->log_opened = 0;
+#endif
+#if LDB_SUMMARY
+    db->sum_opened = 0;
+#endif
 
-    if(LDB_MUTEX_CREATE(&db->mutex))
+    if(LDB_MUTEX_CREATE(db->pmutex))
 	return LDB_ERR_MUTEX;
     
     return LDB_OK;
@@ -82,28 +855,49 @@ LDB_RES ldb_close(LighDB *db)
 {
     if(db == 0)
 	return LDB_ERR_ZERO_POINTER;
-    if(LDB_MUTEX_REQUEST(&db->mutex))  //reQuest MUTEX
+    if(db_lock(db))  //reQuest MUTEX
 	return LDB_ERR_MUTEX;	
     if(db->opened == 0)
     {
-	LDB_MUTEX_RELEASE(&db->mutex); //reLease MUTEX
+	db_unlock(db); //reLease MUTEX
 	return LDB_ERR_NOT_OPENED;
     }
     db->opened    = 0;
     db->buffer_id = 0;
     db->buffer_id_size = 0;
+    db->snapshots = 0;
+#if LDB_CHANGELOG
+    if(db->log_opened)
+	ldb_io_close(&db->file_log);
+    db->log_opened = 0;
+#endif
+#if LDB_SUMMARY
+    if(db->sum_opened)
+	ldb_io_close(&db->file_sum);
+    db->sum_opened = 0;
+#endif
+    if(db->env != 0)
+    {
+	//files and mutex belong to env
+	if(db->env->buffer_owner == db)
+	    db->env->buffer_owner = 0;
+	db->env->tables_opened --;
+	if(db_unlock(db))  //reLease MUTEX
+	    return LDB_ERR_MUTEX;
+	return LDB_OK;
+    }
 
-    if(ldb_io_close(&db->file_index)) {
-	ldb_io_close(&db->file_data);
-	LDB_MUTEX_RELEASE(&db->mutex); //reLease MUTEX
+    if(ldb_io_close(db->pfile_index)) {
+	ldb_io_close(db->pfile_data);
+	db_unlock(db); //reLease MUTEX
 	return LDB_ERR_IO;
     }
-    if(ldb_io_close(&db->file_data))
+    if(ldb_io_close(db->pfile_data))
     {
-	LDB_MUTEX_RELEASE(&db->mutex); //reLease MUTEX
+	db_unlock(db); //reLease MUTEX
 	return LDB_ERR_IO;
     }
-    if(LDB_MUTEX_RELEASE(&db->mutex))  //reLease MUTEX
+    if(db_unlock(db))  //reLease MUTEX
 	return LDB_ERR_MUTEX;	
     if(LDB_MUTEX_DELETE(&db->mutex))
 	return LDB_ERR_MUTEX;	
@@ -114,63 +908,203 @@ LDB_RES ldb_set_buffer(LighDB *db, uint32_t *buffer, uint32_t size)
 {
     if(db == 0 || buffer == 0)
 	return LDB_ERR_ZERO_POINTER;
-    if(size < LDB_MIN_ID_BUFF)
+    if(size / 4 < LDB_MIN_ID_BUFF)
 	return LDB_ERR_SMALL_BUFFER;
-    if(LDB_MUTEX_REQUEST(&db->mutex))   //reQuest MUTEX
+    if(db_lock(db))   //reQuest MUTEX
 	return LDB_ERR_MUTEX;	
     if(db->opened == 0)
     {
-	LDB_MUTEX_RELEASE(&db->mutex);  //reLease MUTEX
+	db_unlock(db);  //reLease MUTEX
 	return LDB_ERR_NOT_OPENED;
     }
+    if(size / 4 < min_buf_size(db))
+    {
+	db_unlock(db);  //reLease MUTEX
+	return LDB_ERR_SMALL_BUFFER;
+    }
+#if LDB_SHARED
+    if(db->shared != 0)
+    {
+	//buffer is in shared block
+	db_unlock(db);  //reLease MUTEX
+	return LDB_ERR;
+    }
+#endif
     db->buffer_id = (uint32_t*)buffer;
-    db->buffer_id_size = size;
-    if(LDB_MUTEX_RELEASE(&db->mutex))   //reLease MUTEX
+    db->buffer_id_size = size / 4;
+    db->buffer_id_count = 0;
+    if(db_unlock(db))   //reLease MUTEX
 	return LDB_ERR_MUTEX;	
     return LDB_OK;
 }
 #if !LDB_READ_ONLY
 static LDB_RES update_sysheader(LighDB *db)
 {
-    if(ldb_io_lseek(&db->file_index, 0, SEEK_SET))
+    if(ldb_io_lseek(db->pfile_index, db->index_base, SEEK_SET))
 	return LDB_ERR_IO;
     uint32_t bw;
-    if(ldb_io_write(&db->file_index,
-		    (uint8_t*)&db->h, sizeof(db->h), &bw)) {
-	ldb_io_close(&db->file_index);
+    if(ldb_io_write(db->pfile_index,
+		    (uint8_t*)&db->h, sysheader_size(db), &bw)) {
+	if(db->env == 0) //file of env is used by other tables
+	    ldb_io_close(db->pfile_index);
 	return LDB_ERR_IO;
     }
     //check written db header size
-    if(sizeof(db->h) != bw) {
-	ldb_io_close(&db->file_index);
+    if(sysheader_size(db) != bw) {
+	if(db->env == 0)
+	    ldb_io_close(db->pfile_index);
 	return LDB_ERR_IO;
     }
    
     return LDB_OK;
 }
-LDB_RES ldb_create(LighDB *db, char *path_index, char *path_data,
-		   uint32_t size,
-		   uint32_t header_size, uint8_t *header)
+#if LDB_CHANGELOG
+//append change record to change log if it is opened
+static LDB_RES log_append(LighDB *db, uint8_t op,
+			  uint32_t index, uint32_t id,
+			  uint8_t *data, uint32_t size)
 {
-    if(db == 0 || path_index == 0 || path_data == 0)
-	return LDB_ERR_ZERO_POINTER;
-    if(size == 0)
-	return LDB_ERR;
+    if(db->log_opened == 0)
+	return LDB_OK;
+    LDB_CHANGE ch;
+    ch.seq = db->log_seq + 1;
+    ch.op = op;
+    ch.index = index;
+    ch.id = id;
+    ch.size = size;
+    uint32_t bw;
+    if(ldb_io_lseek(&db->file_log, db->log_size, SEEK_SET) ||
+       ldb_io_write(&db->file_log, (uint8_t*)&ch, sizeof(ch), &bw) ||
+       ldb_io_write(&db->file_log, data, size, &bw))
+	return LDB_ERR_IO;
+    db->log_seq = ch.seq;
+    db->log_size += sizeof(ch) + size;
+    return LDB_OK;
+}
+#else
+#define log_append(db, op, index, id, data, size) LDB_OK
+#endif
+#if LDB_SUMMARY
+#define SUM_HEADER 22 //version, ids_per_page, bloom_size, count
+#define SUM_ENTRY (8 + LDB_SUMMARY_BLOOM)
+#define SUM_BITS (LDB_SUMMARY_BLOOM * 8)
 
-    //open index file
-    if(ldb_io_open(&db->file_index, path_index, 1)) {
-	
+//bits of ID in bloom filter are taken from halves of the hash
+static uint32_t sum_hash(uint32_t id)
+{
+    id ^= id >> 16;
+    id *= 0x85ebca6b;
+    id ^= id >> 13;
+    id *= 0xc2b2ae35;
+    id ^= id >> 16;
+    return id;
+}
+static LDB_RES sum_write_count(LighDB *db, uint32_t count)
+{
+    uint32_t bw;
+    if(ldb_io_lseek(&db->file_sum, SUM_HEADER - 4, SEEK_SET) ||
+       ldb_io_write(&db->file_sum, (uint8_t*)&count, 4, &bw) ||
+       bw != 4)
 	return LDB_ERR_IO;
+    return LDB_OK;
+}
+//set bit of bloom filter of page in file
+static LDB_RES sum_set_bit(LighDB *db, uint32_t page, uint32_t bit)
+{
+    uint32_t off = SUM_HEADER + page * SUM_ENTRY + 8 + bit / 8, br;
+    uint8_t v;
+    if(ldb_io_lseek(&db->file_sum, off, SEEK_SET) ||
+       ldb_io_read(&db->file_sum, &v, 1, &br) || br != 1)
+	return LDB_ERR_IO;
+    v |= 1 << (bit % 8);
+    if(ldb_io_lseek(&db->file_sum, off, SEEK_SET) ||
+       ldb_io_write(&db->file_sum, &v, 1, &br) || br != 1)
+	return LDB_ERR_IO;
+    return LDB_OK;
+}
+//add ID of new item to summary if it is opened
+static LDB_RES sum_add(LighDB *db, uint32_t index, uint32_t id)
+{
+    static const uint8_t zero[64] = {0};
+    uint32_t page = index / LDB_SUMMARY_IDS, h = sum_hash(id);
+    uint32_t off = SUM_HEADER + page * SUM_ENTRY, mm[2], i, bw;
+    LDB_RES r;
+    //summary behind the table isn't continued, its pages are read anyway
+    if(db->sum_opened == 0 || db->sum_count != index)
+	return LDB_OK;
+    if(index % LDB_SUMMARY_IDS == 0)
+    {
+	//new page
+	mm[0] = mm[1] = id;
+	if(ldb_io_lseek(&db->file_sum, off, SEEK_SET) ||
+	   ldb_io_write(&db->file_sum, (uint8_t*)mm, 8, &bw) || bw != 8)
+	    return LDB_ERR_IO;
+	for (i = 0; i < LDB_SUMMARY_BLOOM; i += bw)
+	    if(ldb_io_write(&db->file_sum, (uint8_t*)zero,
+			    LDB_SUMMARY_BLOOM - i < sizeof(zero) ?
+			    LDB_SUMMARY_BLOOM - i : sizeof(zero), &bw) ||
+	       bw == 0)
+		return LDB_ERR_IO;
     }
-    //set db opened
-    db->opened    = 1;
-    //copy version
-    for (uint8_t i = 0; i < 10; i++)
-	db->h.version[i] = ldb_ver[i];
+    else
+    {
+	if(ldb_io_lseek(&db->file_sum, off, SEEK_SET) ||
+	   ldb_io_read(&db->file_sum, (uint8_t*)mm, 8, &bw) || bw != 8)
+	    return LDB_ERR_IO;
+	if(id < mm[0] || id > mm[1])
+	{
+	    if(id < mm[0])
+		mm[0] = id;
+	    if(id > mm[1])
+		mm[1] = id;
+	    if(ldb_io_lseek(&db->file_sum, off, SEEK_SET) ||
+	       ldb_io_write(&db->file_sum, (uint8_t*)mm, 8, &bw) || bw != 8)
+		return LDB_ERR_IO;
+	}
+    }
+    if((r = sum_set_bit(db, page, h % SUM_BITS)) ||
+       (r = sum_set_bit(db, page, (h >> 16) % SUM_BITS)) ||
+       (r = sum_write_count(db, index + 1)))
+	return r;
+    db->sum_count = index + 1;
+    return LDB_OK;
+}
+#else
+#define sum_add(db, index, id) LDB_OK
+#endif
+static LDB_RES create_db(LighDB *db, char *path_index, char *path_data,
+			 uint32_t size,
+			 uint32_t header_size, uint8_t *header,
+			 uint32_t flags, LDB_FIELD *fields, uint32_t count)
+{
+    if(db == 0 || path_index == 0 || path_data == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(size == 0)
+	return LDB_ERR;
+    if((flags & ~LDB_F_SUPPORTED) ||
+       ((flags & LDB_F_ALIGN_ROWS) && !(flags & LDB_F_ALIGNED)) ||
+       ((flags & LDB_F_PACKED_IDS) && (flags & LDB_F_CRC)))
+	return LDB_ERR_HEADER;
+    own_files(db);
+
+    //open index file
+    if(ldb_io_open(db->pfile_index, path_index, 1)) {
+	
+	return LDB_ERR_IO;
+    }
+    //set db opened
+    db->opened    = 1;
+    //copy version. Without format flags layout of version 001 is used,
+    //because older library opens newer versions with wrong offsets.
+    //LDB_F_SORTED requested by caller needs flags field to be kept
+    char *ver = flags ? ldb_ver : ldb_ver_v1;
+    for (uint8_t i = 0; i < 10; i++)
+	db->h.version[i] = ver[i];
     //set header
     db->h.header_size = header_size;
     db->h.item_size = size;
     db->h.count = 0;
+    db->h.flags = flags | LDB_F_SORTED; //empty table is sorted
     
     uint32_t bw;
     LDB_RES r;
@@ -180,158 +1114,252 @@ LDB_RES ldb_create(LighDB *db, char *path_index, char *path_data,
     if(header != 0 && header_size != 0)
     {
 	//write user header
-	if(ldb_io_write(&db->file_index,
+	if(ldb_io_write(db->pfile_index,
 			header, header_size, &bw)) {
-	    ldb_io_close(&db->file_index);
+	    ldb_io_close(db->pfile_index);
 	    return LDB_ERR_IO;
 	}
 	//check written user header size
 	if(header_size != bw) {
-	    ldb_io_close(&db->file_index);
+	    ldb_io_close(db->pfile_index);
 	    return LDB_ERR_IO;
 	}
     }
     
     //open data file
-    if(ldb_io_open(&db->file_data, path_data, 1)) {
+    if(ldb_io_open(db->pfile_data, path_data, 1)) {
 	return LDB_ERR_IO;
     }
     //write version in data file
-    if(ldb_io_write(&db->file_data,
-		    (uint8_t*)ldb_ver, 10, &bw)) {
-	ldb_io_close(&db->file_index);
-	ldb_io_close(&db->file_data);
+    if(ldb_io_write(db->pfile_data,
+		    (uint8_t*)ver, 10, &bw)) {
+	ldb_io_close(db->pfile_index);
+	ldb_io_close(db->pfile_data);
 	return LDB_ERR_IO;
     }
+#if LDB_PAX
+    if(flags & LDB_F_PAX)
+    {
+	//write table of fields after version
+	uint32_t hdr[2] = {LDB_PAX_BLOCK, count};
+	db->pax_block = LDB_PAX_BLOCK;
+	db->pax_fields = count;
+	memcpy(db->pax, fields, count * sizeof(LDB_FIELD));
+	if(ldb_io_write(db->pfile_data, (uint8_t*)hdr, 8, &bw) ||
+	   ldb_io_write(db->pfile_data, (uint8_t*)db->pax,
+			count * sizeof(LDB_FIELD), &bw)) {
+	    ldb_io_close(db->pfile_index);
+	    ldb_io_close(db->pfile_data);
+	    return LDB_ERR_IO;
+	}
+    }
+#else
+    (void)fields;
+    (void)count;
+#endif
 
     //calculate index table offset
-    db->index_offset = sizeof(db->h) + header_size;
-    db->data_offset = 10;
+    db->index_offset = align_up(db, sysheader_size(db) + header_size);
+    db->data_offset = align_up(db, data_start(db));
+#if LDB_ID_PACK
+    db->pack_dir = LDB_PACK_DIR;
+    db->pack_size = 0;
+    if((flags & LDB_F_PACKED_IDS) && pack_sizes(db)) {
+	ldb_io_close(db->pfile_index);
+	ldb_io_close(db->pfile_data);
+	return LDB_ERR_IO;
+    }
+#endif
     
     //clear buffer pointers
     db->buffer_id = 0;
     db->buffer_id_size = 0;
+    db->buffer_id_count = 0;
+    db->snapshots = 0;
+#if LDB_CHANGELOG
+    db->log_opened = 0;
+#endif
+#if LDB_SUMMARY
+    db->sum_opened = 0;
+#endif
 
-    if(LDB_MUTEX_CREATE(&db->mutex))
+    if(LDB_MUTEX_CREATE(db->pmutex))
 	return LDB_ERR_MUTEX;	
     
     return LDB_OK;
 }
+LDB_RES ldb_create(LighDB *db, char *path_index, char *path_data,
+		   uint32_t size,
+		   uint32_t header_size, uint8_t *header)
+{
+    return ldb_create_ex(db, path_index, path_data,
+			 size, header_size, header, 0);
+}
+LDB_RES ldb_create_ex(LighDB *db, char *path_index, char *path_data,
+		      uint32_t size,
+		      uint32_t header_size, uint8_t *header,
+		      uint32_t flags)
+{
+    //fields are set by ldb_create_pax()
+    if(flags & LDB_F_PAX)
+	return LDB_ERR_HEADER;
+    return create_db(db, path_index, path_data, size,
+		     header_size, header, flags, 0, 0);
+}
+#if LDB_PAX
+LDB_RES ldb_create_pax(LighDB *db, char *path_index, char *path_data,
+		       uint32_t size,
+		       uint32_t header_size, uint8_t *header,
+		       uint32_t flags, LDB_FIELD *fields, uint32_t count)
+{
+    if(fields == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(pax_check(fields, count, size))
+	return LDB_ERR;
+    //items are split to fields, so they have no checksums and can't be padded
+    if(flags & (LDB_F_CRC | LDB_F_ALIGN_ROWS))
+	return LDB_ERR_HEADER;
+    return create_db(db, path_index, path_data, size,
+		     header_size, header, flags | LDB_F_PAX, fields, count);
+}
+#endif
 #endif
 inline static LDB_RES chk_db(LighDB *db)
 {
     if(db == 0)
 	return LDB_ERR_ZERO_POINTER;
-    if(LDB_MUTEX_REQUEST(&db->mutex)) //reQuest MUTEX
+    if(db_lock(db)) //reQuest MUTEX
 	return LDB_ERR_MUTEX;	
     if(db->opened == 0)
     {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_NOT_OPENED;
     }
     if(db->buffer_id == 0)
     {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_NO_BUFFER;
     }
+    //buffer of env could be used by other table
+    if(db->env != 0 && db->buffer_id == db->env->buffer &&
+       db->env->buffer_owner != db)
+    {
+	db->buffer_id_count = 0;
+	db->env->buffer_owner = db;
+    }
     return LDB_OK;
 }
-LDB_RES ldb_get(LighDB *db, uint32_t id,
-		uint8_t *buf, uint32_t size)
+LDB_RES ldb_get_ind(LighDB *db, uint32_t index,
+		    uint8_t *buf, uint32_t size)
 {
     LDB_RES r;
-    if((r = chk_db(db)))               //reQuest MUTEX
+    if(buf == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))              //reQuest MUTEX
 	return r;
-
-    uint32_t index, count;
-    //find first element with ID
-    if(LDB_MUTEX_RELEASE(&db->mutex))  //reLease MUTEX
-	return LDB_ERR_MUTEX;
-    r = ldb_find_by_id(db, id, &count, &index, 1);
-    if(LDB_MUTEX_REQUEST(&db->mutex))  //reQuest MUTEX
-	return LDB_ERR_MUTEX;	
-    if(r != LDB_OK)
-    {
-	LDB_MUTEX_RELEASE(&db->mutex); //reLease MUTEX
-	return LDB_ERR_NO_ID;
-    }
-    if(count == 0) //if 0 elements found
+    if(size < db->h.item_size)
     {
-	LDB_MUTEX_RELEASE(&db->mutex); //reLease MUTEX
-	return LDB_ERR_NO_ID;
+	db_unlock(db);//reLease MUTEX
+	return LDB_ERR_SMALL_BUFFER;
     }
-    if(LDB_MUTEX_RELEASE(&db->mutex))  //reLease MUTEX
-	return LDB_ERR_MUTEX;	
-    return ldb_get_ind(db, index, buf, size);
+    
+    r = read_item(db, index, buf);
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
 }
-
-#if !LDB_READ_ONLY
-LDB_RES ldb_upd(LighDB *db, uint32_t id,
-		void *data, uint32_t size)
+LDB_RES ldb_get_range(LighDB *db, uint32_t index, uint32_t count,
+		      uint8_t *buf, uint32_t size)
 {
     LDB_RES r;
+    if(buf == 0)
+	return LDB_ERR_ZERO_POINTER;
     if((r = chk_db(db)))              //reQuest MUTEX
 	return r;
-    
-    uint32_t index, count;
-    //find first element with ID
-    if(LDB_MUTEX_RELEASE(&db->mutex)) //reLease MUTEX
-	return LDB_ERR_MUTEX;	
-    r = ldb_find_by_id(db, id, &count, &index, 1);
-    if(LDB_MUTEX_REQUEST(&db->mutex)) //reQuest MUTEX
-	return LDB_ERR_MUTEX;	
-    if(r != LDB_OK)
+    uint32_t i, br, isize = db->h.item_size;
+    if(index > db->h.count || count > db->h.count - index)
+	r = LDB_BIG_INDEX;
+    else if(size / isize < count)
+	r = LDB_ERR_SMALL_BUFFER;
+#if LDB_PAX
+    else if(db->h.flags & LDB_F_PAX)
     {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_NO_ID;
+	//buffer of DB is used to collect fields
+	uint32_t n, max = db->buffer_id_size * 4 / pax_max_len(db);
+	db->buffer_id_count = 0;
+	if(max == 0)
+	    r = LDB_ERR_SMALL_BUFFER;
+	for (i = 0; i < count && r == LDB_OK; i += n) {
+	    n = count - i < max ? count - i : max;
+	    r = pax_read_items(db, index + i, n, buf + i * isize,
+			       (uint8_t*)db->buffer_id);
+	}
     }
-    if(count == 0) //if 0 elements found
+#endif
+    else if(item_stride(db) == isize)
     {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_NO_ID;
+	//items are one by one in file, so read them at once
+	if(count != 0 &&
+	   (ldb_io_lseek(db->pfile_data,
+			 db->data_offset + isize * index,
+			 SEEK_SET) ||
+	    ldb_io_read(db->pfile_data, buf, count * isize, &br) ||
+	    br != count * isize))
+	    r = LDB_ERR_IO;
     }
-    if(LDB_MUTEX_RELEASE(&db->mutex)) //reLease MUTEX
-	return LDB_ERR_MUTEX;	
-    
-    return ldb_upd_ind(db, index, data, size);
+    else
+	for (i = 0; i < count && r == LDB_OK; i++)
+	    r = read_item(db, index + i, buf + i * isize);
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
 }
-#endif
-static LDB_RES ldb_seek_ind_data(LighDB *db, uint32_t index)
+#if !LDB_READ_ONLY
+//save old version of item for every snapshot which sees it
+static LDB_RES snapshots_save(LighDB *db, uint32_t index)
 {
-    if(index >= db->h.count)
-	return LDB_BIG_INDEX;
-    if(ldb_io_lseek(&db->file_data,
-		    db->data_offset +
-		    (db->h.item_size * index),
-		    SEEK_SET))
-	return LDB_ERR_IO;
+    LDB_SNAPSHOT *snap;
+    uint32_t i, ind, esize = 4 + db->h.item_size;
+    uint8_t *e;
+    for (snap = db->snapshots; snap != 0; snap = snap->next) {
+	if(index >= snap->count || snap->overflow)
+	    continue;
+	//item could be already saved
+	for (i = 0; i < snap->undo_count; i++) {
+	    memcpy(&ind, snap->undo + i * esize, 4);
+	    if(ind == index)
+		break;
+	}
+	if(i < snap->undo_count)
+	    continue;
+	if((snap->undo_count + 1) * esize > snap->undo_size)
+	{
+	    //don't block writer, just make snapshot invalid
+	    snap->overflow = 1;
+	    continue;
+	}
+	e = snap->undo + snap->undo_count * esize;
+	memcpy(e, &index, 4);
+	LDB_RES r;
+	if((r = read_item(db, index, e + 4)))
+	    return r;
+	snap->undo_count ++;
+    }
     return LDB_OK;
 }
-LDB_RES ldb_get_ind(LighDB *db, uint32_t index,
-		    uint8_t *buf, uint32_t size)
+//update item. Mutex must be taken
+static LDB_RES upd_item(LighDB *db, uint32_t index, uint8_t *data)
 {
     LDB_RES r;
-    if(buf == 0)
-	return LDB_ERR_ZERO_POINTER;
-    if((r = chk_db(db)))              //reQuest MUTEX
+    if(index >= db->h.count)
+	return LDB_BIG_INDEX;
+    if((r = snapshots_save(db, index)))
 	return r;
-    if(size < db->h.item_size)
-    {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_SMALL_BUFFER;
-    }
-    
-    if((r = ldb_seek_ind_data(db, index)))
+    if((r = write_item(db, index, data)))
 	return r;
-    uint32_t br;
-    if(ldb_io_read(&db->file_data, buf, db->h.item_size, &br))
-    {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_IO;
-    }
-    return LDB_OK;
+    return log_append(db, LDB_CHANGE_UPD, index, 0,
+		      data, db->h.item_size);
 }
-#if !LDB_READ_ONLY
 LDB_RES ldb_upd_ind(LighDB *db, uint32_t index,
 		    void *data, uint32_t size)
 {
@@ -342,23 +1370,13 @@ LDB_RES ldb_upd_ind(LighDB *db, uint32_t index,
 	return r;
     if(size < db->h.item_size)
     {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_SMALL_BUFFER;
     }
-    if((r = ldb_seek_ind_data(db, index)))
-    {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return r;
-    }
-    uint32_t bw;
-    if(ldb_io_write(&db->file_data, data, db->h.item_size, &bw))
-    {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_IO;
-    }
-    if(LDB_MUTEX_RELEASE(&db->mutex))
+    r = upd_item(db, index, data);
+    if(db_unlock(db))
 	return LDB_ERR_MUTEX;	      //reLease MUTEX
-    return LDB_OK;    
+    return r;
 }
 
 LDB_RES ldb_add(LighDB *db,
@@ -371,107 +1389,447 @@ LDB_RES ldb_add(LighDB *db,
     if((r = chk_db(db)))              //reQuest MUTEX
     	return r;
     if(size < db->h.item_size) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
+	return LDB_ERR_SMALL_BUFFER;
+    }
+    //table of env has no room after capacity
+    if(db->capacity != 0 && db->h.count >= db->capacity) {
+	db_unlock(db);//reLease MUTEX
+	return LDB_ERR_FULL;
+    }
+#if LDB_ID_PACK
+    //block of IDs is packed in buffer, so it is checked before item is written
+    if((db->h.flags & LDB_F_PACKED_IDS) && db->buffer_id_size < LDB_PACK_IDS) {
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_SMALL_BUFFER;
     }
+#endif
 
     //add to data
-    if(ldb_io_lseek(&db->file_data,
-		    db->data_offset +
-		    (db->h.item_size * db->h.count),
-		    SEEK_SET)) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_IO;
-    }
-    uint32_t bw;
-    if(ldb_io_write(&db->file_data, data, db->h.item_size, &bw)) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_IO;
+    if((r = write_item(db, db->h.count, data))) {
+	db_unlock(db);//reLease MUTEX
+	return r;
     }
     //add in ID table
-    if(ldb_io_lseek(&db->file_index,
-		    db->index_offset +
-		    (4 * db->h.count),
-		    SEEK_SET)) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_IO;
-    }
-    if(ldb_io_write(&db->file_index, (uint8_t*)&id, sizeof(uint32_t), &bw)) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
-	return LDB_ERR_IO;
+    if((r = append_id(db, db->h.count, id))) {
+	db_unlock(db);//reLease MUTEX
+	return r;
     }
 
     //return new index
     if(newindex != 0)
 	*newindex = db->h.count;
     
+    //first ID less than previous makes table unsorted forever
+    if(db->h.count != 0 && id < db->last_id)
+	db->h.flags &= ~LDB_F_SORTED;
+    db->last_id = id;
     db->h.count ++;
     //update count in db header
     if((r = update_sysheader(db))) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
+	return r;
+    }
+    if((r = log_append(db, LDB_CHANGE_ADD, db->h.count - 1, id,
+		       data, db->h.item_size))) {
+	db_unlock(db);//reLease MUTEX
+	return r;
+    }
+    if((r = sum_add(db, db->h.count - 1, id))) {
+	db_unlock(db);//reLease MUTEX
 	return r;
     }
 
-    //insert id in ID table
-    if(db->buffer_id_count < db->buffer_id_size &&
-       db->buffer_id_start_index + db->buffer_id_size < db->buffer_id_count)
+    //insert id in ID table in buffer if buffer has the end of table
+    if(db->buffer_id_count != 0 &&
+       db->buffer_id_count < buf_ids_size(db) &&
+       db->buffer_id_start_index + db->buffer_id_count == db->h.count - 1)
     {
 	db->buffer_id[db->buffer_id_count] = id;
+	db->buffer_id_count ++;
     }
-    if(LDB_MUTEX_RELEASE(&db->mutex)) //reLease MUTEX
+    if(db_unlock(db)) //reLease MUTEX
 	return LDB_ERR_MUTEX;	
 
     return LDB_OK;    
 }
+//close DB which failed to load. Its files keep empty DB, because header is written at the end
+static LDB_RES bulk_fail(LighDB *db, LDB_RES r)
+{
+    db_unlock(db);    //reLease MUTEX
+    ldb_close(db);
+    return r;
+}
+LDB_RES ldb_bulk_load(LighDB *db, char *path_index, char *path_data,
+		      uint32_t size,
+		      uint32_t header_size, uint8_t *header,
+		      uint32_t *buffer, uint32_t buffer_size,
+		      ldb_bulk_reader reader, void *arg)
+{
+    LDB_RES r;
+    if(reader == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = ldb_create(db, path_index, path_data,
+		       size, header_size, header)))
+	return r;
+    if((r = ldb_set_buffer(db, buffer, buffer_size)))
+    {
+	ldb_close(db);
+	return r;
+    }
+    if((r = chk_db(db)))                  //reQuest MUTEX
+	return r;
+    //buffer: |IDs of batch|items of batch|
+    uint32_t batch = db->buffer_id_size * 4 / (4 + size);
+    if(batch == 0)
+	return bulk_fail(db, LDB_ERR_SMALL_BUFFER);
+    uint32_t *ids = db->buffer_id;
+    uint8_t *items = (uint8_t*)(db->buffer_id + batch);
+    uint32_t n, bw;
+    uint8_t res = 1;
+    do {
+	//collect batch
+	for (n = 0; n < batch; n++) {
+	    if((res = reader(items + n * size, &ids[n], arg)) != 1)
+		break;
+	    if(db->h.count + n != 0 && ids[n] < db->last_id)
+		db->h.flags &= ~LDB_F_SORTED;
+	    db->last_id = ids[n];
+	}
+	if(res > 1)
+	    return bulk_fail(db, LDB_ERR);
+	if(n == 0)
+	    break;
+	if(ldb_io_lseek(db->pfile_data,
+			db->data_offset + size * db->h.count,
+			SEEK_SET) ||
+	   ldb_io_write(db->pfile_data, items, n * size, &bw) ||
+	   ldb_io_lseek(db->pfile_index,
+			db->index_offset + 4 * db->h.count,
+			SEEK_SET) ||
+	   ldb_io_write(db->pfile_index, (uint8_t*)ids, n * 4, &bw))
+	    return bulk_fail(db, LDB_ERR_IO);
+	db->h.count += n;
+    } while(n == batch);
+    //buffer doesn't contain ID table
+    db->buffer_id_count = 0;
+    //items become visible only now
+    if((r = update_sysheader(db)))
+	return bulk_fail(db, r);
+    if(db_unlock(db))     //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
 #endif
+//load IDs from index sind to buffer. With LDB_F_CRC sind must be first index of page.
+//If checksum is wrong then buffer_id_start_index is first index of damaged page
 static LDB_RES load_buf(LighDB *db, uint32_t sind)
 {
     if(sind >= db->h.count)
 	return LDB_ERR;
+    uint32_t size = buf_ids_size(db);
+    if(size == 0)
+	return LDB_ERR_SMALL_BUFFER;
     
     db->buffer_id_start_index = sind; //set first index
     //calculate count
     db->buffer_id_count = db->h.count - sind; 
-    if(db->buffer_id_count > db->buffer_id_size)
-	db->buffer_id_count = db->buffer_id_size;
+    if(db->buffer_id_count > size)
+	db->buffer_id_count = size;
+#if LDB_ID_PACK
+    if((db->h.flags & LDB_F_PACKED_IDS) &&
+       sind < db->h.count / LDB_PACK_IDS * LDB_PACK_IDS)
+    {
+	//packed values are read to the end of block and unpacked in place
+	LDB_ID_BLOCK h;
+	LDB_RES r;
+	uint32_t br, plen;
+	//sheet is whole block
+	db->buffer_id_start_index -= sind % LDB_PACK_IDS;
+	db->buffer_id_count = LDB_PACK_IDS;
+	if((r = pack_header(db, sind / LDB_PACK_IDS, &h)))
+	{
+	    db->buffer_id_count = 0;
+	    return r;
+	}
+	plen = h.bits * LDB_PACK_IDS / 8;
+	if(plen != 0 &&
+	   (ldb_io_lseek(db->pfile_index, pack_values(db) + h.off, SEEK_SET) ||
+	    ldb_io_read(db->pfile_index,
+			(uint8_t*)db->buffer_id + LDB_PACK_IDS * 4 - plen,
+			plen, &br) ||
+	    br != plen))
+	{
+	    db->buffer_id_count = 0;
+	    return LDB_ERR_IO;
+	}
+	unpack_ids(db->buffer_id, &h);
+	return LDB_OK;
+    }
+#endif
+    uint32_t len = db->buffer_id_count * 4;
+#if LDB_CRC
+    if(db->h.flags & LDB_F_CRC)
+	len = (db->buffer_id_count + LDB_CRC_PAGE_IDS - 1) /
+	    LDB_CRC_PAGE_IDS * (LDB_CRC_PAGE_IDS + 1) * 4;
+#endif
     //load table
     uint32_t br;
-    ldb_io_lseek(&db->file_index,
-		 db->index_offset + db->buffer_id_start_index * 4,
-		 SEEK_SET);
-    ldb_io_read(&db->file_index, (uint8_t*)db->buffer_id,
-		db->buffer_id_count * 4, &br);
-    if(br != db->buffer_id_count * 4)
+    if(ldb_io_lseek(db->pfile_index, id_offset(db, sind), SEEK_SET) ||
+       ldb_io_read(db->pfile_index, (uint8_t*)db->buffer_id, len, &br) ||
+       br != len)
+    {
+	db->buffer_id_count = 0;
 	return LDB_ERR_IO;
+    }
+    //next sheet is read while this one is scanned
+    if(sind + db->buffer_id_count < db->h.count)
+	LDB_READAHEAD(db->pfile_index,
+		      id_offset(db, sind + db->buffer_id_count), len);
+#if LDB_CRC
+    if(db->h.flags & LDB_F_CRC)
+    {
+	//check pages and remove checksums from buffer
+	uint32_t p, n, *page;
+	for (p = 0; p * LDB_CRC_PAGE_IDS < db->buffer_id_count; p++) {
+	    n = db->buffer_id_count - p * LDB_CRC_PAGE_IDS;
+	    if(n > LDB_CRC_PAGE_IDS)
+		n = LDB_CRC_PAGE_IDS;
+	    page = db->buffer_id + p * (LDB_CRC_PAGE_IDS + 1);
+	    if(page[LDB_CRC_PAGE_IDS] != crc32c(0, (uint8_t*)page, n * 4))
+	    {
+		db->buffer_id_start_index = sind + p * LDB_CRC_PAGE_IDS;
+		db->buffer_id_count = 0;
+		return LDB_ERR_CRC;
+	    }
+	    memmove(db->buffer_id + p * LDB_CRC_PAGE_IDS, page, n * 4);
+	}
+    }
+#endif
     
     return LDB_OK;
 }
-LDB_RES ldb_find_by_id(LighDB *db, uint32_t id,
-		       uint32_t *count,
-		       uint32_t *list, uint32_t len)
+#if LDB_ID_PACK
+//binary search in directory for first block with max >= id.
+//IDs after blocks aren't packed, so *from is index after blocks if there is no such block
+static LDB_RES pack_from(LighDB *db, uint32_t id, uint32_t *from)
 {
     LDB_RES r;
-    if(len == 0)
-	return LDB_OK;
-    if((r = chk_db(db)))                  //reQuest MUTEX
-    	return r;
-
-    uint32_t l = db->h.count; //how many indexes left
-    uint32_t i, was_zero;
-    
-    if(db->buffer_id_count == 0)
-	if((r = load_buf(db, 0))) {
-	    LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+    LDB_ID_BLOCK h;
+    uint32_t lo = 0, hi = db->h.count / LDB_PACK_IDS, mid;
+    while(lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if((r = pack_header(db, mid, &h)))
+	    return r;
+	if(h.max < id)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    *from = lo * LDB_PACK_IDS;
+    return LDB_OK;
+}
+#endif
+//find index from which sorted ID table is scanned for ID: first index with
+//ID >= id or some index before it, but not farther than buffer size.
+//Sheet in buffer is used as fence, other IDs are read one by one
+static LDB_RES sorted_from(LighDB *db, uint32_t id, uint32_t *from)
+{
+    uint32_t lo = 0, hi = db->h.count, mid, v, br;
+    uint32_t *b = db->buffer_id, n = db->buffer_id_count;
+#if LDB_ID_PACK
+    //packed table is searched in directory of blocks
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return pack_from(db, id, from);
+#endif
+    if(n != 0)
+    {
+	if(b[0] >= id)
+	    hi = db->buffer_id_start_index;
+	else if(b[n - 1] < id)
+	    lo = db->buffer_id_start_index + n;
+	else
+	{
+	    //it is in buffer
+	    lo = 0;
+	    hi = n - 1;
+	    while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if(b[mid] < id)
+		    lo = mid + 1;
+		else
+		    hi = mid;
+	    }
+	    *from = db->buffer_id_start_index + lo;
+	    return LDB_OK;
+	}
+    }
+    //binary search in file till the rest fits in buffer
+    while(hi - lo > buf_ids_size(db)) {
+	mid = lo + (hi - lo) / 2;
+	if(ldb_io_lseek(db->pfile_index, id_offset(db, mid), SEEK_SET) ||
+	   ldb_io_read(db->pfile_index, (uint8_t*)&v, 4, &br) ||
+	   br != 4)
+	    return LDB_ERR_IO;
+	if(v < id)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    *from = lo;
+    return LDB_OK;
+}
+#if LDB_SUMMARY
+//move *index to first index of page, which can contain ID by its summary,
+//if page of *index can't. *index is count if there is no such page
+static LDB_RES sum_skip(LighDB *db, uint32_t id, uint32_t *index)
+{
+    uint32_t page = *index / LDB_SUMMARY_IDS, h = sum_hash(id);
+    uint32_t bits[2] = {h % SUM_BITS, (h >> 16) % SUM_BITS}, mm[2], k, br;
+    uint8_t v;
+    for (; page * LDB_SUMMARY_IDS < db->h.count; page++) {
+	//page with items after summary is read anyway
+	if((page + 1) * LDB_SUMMARY_IDS > db->sum_count &&
+	   db->sum_count != db->h.count)
+	    break;
+	if(ldb_io_lseek(&db->file_sum, SUM_HEADER + page * SUM_ENTRY, SEEK_SET) ||
+	   ldb_io_read(&db->file_sum, (uint8_t*)mm, 8, &br) || br != 8)
+	    return LDB_ERR_IO;
+	if(id < mm[0] || id > mm[1])
+	    continue;
+	for (k = 0; k < 2; k++) {
+	    if(ldb_io_lseek(&db->file_sum,
+			    SUM_HEADER + page * SUM_ENTRY + 8 + bits[k] / 8,
+			    SEEK_SET) ||
+	       ldb_io_read(&db->file_sum, &v, 1, &br) || br != 1)
+		return LDB_ERR_IO;
+	    if((v & (1 << (bits[k] % 8))) == 0)
+		break;
+	}
+	if(k == 2)
+	    break;
+    }
+    if(page * LDB_SUMMARY_IDS >= db->h.count)
+	*index = db->h.count;
+    else if(page * LDB_SUMMARY_IDS > *index)
+	*index = page * LDB_SUMMARY_IDS;
+    return LDB_OK;
+}
+#endif
+#if LDB_ID_PACK
+//move *index to first index of packed block, which can contain ID by its min and max,
+//if block of *index can't. *index is count if there is no such block
+static LDB_RES pack_skip(LighDB *db, uint32_t id, uint32_t *index)
+{
+    LDB_RES r;
+    LDB_ID_BLOCK h;
+    uint32_t b = *index / LDB_PACK_IDS, full = db->h.count / LDB_PACK_IDS;
+    for (; b < full; b++) {
+	if((r = pack_header(db, b, &h)))
 	    return r;
+	if(id >= h.min && id <= h.max)
+	    break;
+	//blocks after it have bigger IDs
+	if((db->h.flags & LDB_F_SORTED) && id < h.min)
+	{
+	    *index = db->h.count;
+	    return LDB_OK;
 	}
+    }
+    //IDs after blocks aren't packed and are always read
+    if(b * LDB_PACK_IDS > *index)
+	*index = b * LDB_PACK_IDS;
+    return LDB_OK;
+}
+#endif
+#if LDB_SUMMARY || LDB_ID_PACK
+//count of IDs in pages, which find_ids() can skip without reading, or 0
+static uint32_t skip_page(LighDB *db)
+{
+#if LDB_ID_PACK
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return LDB_PACK_IDS;
+#endif
+#if LDB_SUMMARY
+    if(db->sum_opened && (db->h.flags & LDB_F_SORTED) == 0)
+	return LDB_SUMMARY_IDS;
+#endif
+    return 0;
+}
+//move *index to first page which can contain ID
+static LDB_RES skip_ids(LighDB *db, uint32_t id, uint32_t *index)
+{
+#if LDB_ID_PACK
+    if(db->h.flags & LDB_F_PACKED_IDS)
+	return pack_skip(db, id, index);
+#endif
+#if LDB_SUMMARY
+    return sum_skip(db, id, index);
+#else
+    return LDB_OK;
+#endif
+}
+#endif
+//find indexes of items with ID from index *pos. Mutex must be taken.
+//*pos returns index from which search can be continued, >= count if table is over
+static LDB_RES find_ids(LighDB *db, uint32_t id, uint32_t *pos,
+			uint32_t *count,
+			uint32_t *list, uint32_t len)
+{
+    LDB_RES r;
+    uint32_t i, next, from = 0;
+    uint8_t sorted = (db->h.flags & LDB_F_SORTED) != 0;
+    uint8_t packed = (db->h.flags & LDB_F_PACKED_IDS) != 0;
 
     (*count) = 0;
-    
-    //how many indexes left
-    was_zero = (db->buffer_id_start_index == 0);
-    
-    do {
-	for (i = 0; i < db->buffer_id_count; i++) {
+    //sorted table is scanned from place of ID, other from the beginning
+    if(sorted && db->h.count != 0 && (r = sorted_from(db, id, &from)))
+	return r;
+    if(from < *pos)
+	from = *pos;
+    *pos = db->h.count;
+#if LDB_SUMMARY || LDB_ID_PACK
+    //only pages which can contain ID are scanned
+    uint32_t page = skip_page(db);
+    if(page != 0 && (r = skip_ids(db, id, &from)))
+	return r;
+    uint32_t checked = from; //index which page was checked last
+#endif
+    if(from >= db->h.count)
+	return LDB_OK;
+    //sheet with first index can be already in buffer
+    if(db->buffer_id_count == 0 ||
+       from < db->buffer_id_start_index ||
+       from >= db->buffer_id_start_index + db->buffer_id_count)
+    {
+	next = from;
+	if(db->h.flags & LDB_F_CRC)
+	    next -= from % LDB_CRC_PAGE_IDS;
+	if(packed)
+	    next -= from % LDB_PACK_IDS;
+	if((r = load_buf(db, next)))
+	    return r;
+    }
+    i = from - db->buffer_id_start_index;
+
+    while(1) {
+	for (; i < db->buffer_id_count; i++) {
+#if LDB_SUMMARY || LDB_ID_PACK
+	    next = db->buffer_id_start_index + i;
+	    if(page != 0 && next % page == 0 && next != checked)
+	    {
+		if((r = skip_ids(db, id, &next)))
+		    return r;
+		checked = next;
+		i = next - db->buffer_id_start_index;
+		//page is out of sheet
+		if(i >= db->buffer_id_count)
+		    break;
+	    }
+#endif
+	    //IDs after it are bigger
+	    if(sorted && db->buffer_id[i] > id)
+		return LDB_OK;
 	    if(db->buffer_id[i] == id)
 	    {
 		if(list != 0 && len > (*count))
@@ -480,8 +1838,7 @@ LDB_RES ldb_find_by_id(LighDB *db, uint32_t id,
 		    if(len == (*count) + 1)
 		    {
 			(*count) ++;
-			//reLease MUTEX
-			LDB_MUTEX_RELEASE(&db->mutex);
+			*pos = i + db->buffer_id_start_index + 1;
 			return LDB_OK;
 		    }
 		}
@@ -489,27 +1846,318 @@ LDB_RES ldb_find_by_id(LighDB *db, uint32_t id,
 		(*count) ++;
 	    }
 	}
-	//load next sheet of ID's table
-	if(!was_zero) {
-	    //if zero index wasn't in buffer. Load first index
-	    load_buf(db, 0);
-	    was_zero = 1;
-	    l = db->h.count;
-	} else {
-	    //load next sheet
-	    l -= db->buffer_id_count;   
-	    if(load_buf(db,
-			db->buffer_id_start_index +
-			db->buffer_id_count))
-		break;
-	}
-    } while(l != 0);
+	//load next sheet of ID's table, or sheet with page after skipped ones
+	next = db->buffer_id_start_index + i;
+	if(next >= db->h.count)
+	    return LDB_OK;
+	if((r = load_buf(db, next)))
+	    return r;
+	i = 0;
+    }
+}
+LDB_RES ldb_find_by_id(LighDB *db, uint32_t id,
+		       uint32_t *count,
+		       uint32_t *list, uint32_t len)
+{
+    LDB_RES r;
+    if(len == 0)
+	return LDB_OK;
+    if(count == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))                  //reQuest MUTEX
+    	return r;
 
-    if(LDB_MUTEX_RELEASE(&db->mutex)) //reLease MUTEX
+    uint32_t pos = 0;
+    r = find_ids(db, id, &pos, count, list, len);
+
+    if(db_unlock(db)) //reLease MUTEX
 	return LDB_ERR_MUTEX;	
 
+    return r;
+}
+LDB_RES ldb_find_begin(LighDB *db, LDB_FIND *f, uint32_t id)
+{
+    if(db == 0 || f == 0)
+	return LDB_ERR_ZERO_POINTER;
+    f->db = db;
+    f->id = id;
+    f->next = 0;
     return LDB_OK;
 }
+LDB_RES ldb_find_next(LDB_FIND *f, uint32_t *count,
+		      uint32_t *list, uint32_t len)
+{
+    LDB_RES r;
+    if(f == 0 || count == 0 || list == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(len == 0)
+	return LDB_ERR_SMALL_BUFFER;
+    LighDB *db = f->db;
+    if((r = chk_db(db)))                  //reQuest MUTEX
+	return r;
+    r = find_ids(db, f->id, &f->next, count, list, len);
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+LDB_RES ldb_get(LighDB *db, uint32_t id,
+		uint8_t *buf, uint32_t size)
+{
+    LDB_RES r;
+    if(buf == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))               //reQuest MUTEX
+	return r;
+
+    uint32_t index, count, pos = 0;
+    //find first element with ID and read it without releasing mutex,
+    //so item can't be changed between them
+    if(size < db->h.item_size)
+	r = LDB_ERR_SMALL_BUFFER;
+    else if((r = find_ids(db, id, &pos, &count, &index, 1)) == LDB_OK)
+    {
+	if(count == 0) //if 0 elements found
+	    r = LDB_ERR_NO_ID;
+	else
+	    r = read_item(db, index, buf);
+    }
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;	
+    return r;
+}
+
+#if !LDB_READ_ONLY
+LDB_RES ldb_upd(LighDB *db, uint32_t id,
+		void *data, uint32_t size)
+{
+    LDB_RES r;
+    if(data == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))              //reQuest MUTEX
+	return r;
+    
+    uint32_t index, count, pos = 0;
+    //find first element with ID and update it in the same critical section
+    if(size < db->h.item_size)
+	r = LDB_ERR_SMALL_BUFFER;
+    else if((r = find_ids(db, id, &pos, &count, &index, 1)) == LDB_OK)
+    {
+	if(count == 0) //if 0 elements found
+	    r = LDB_ERR_NO_ID;
+	else
+	    r = upd_item(db, index, data);
+    }
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;	
+    return r;
+}
+//sort positions 0..n-1 by their keys, equal keys stay in order of positions.
+//Shell sort doesn't need memory
+static void sort_by_key(uint32_t *order, uint32_t n, uint32_t *key)
+{
+    uint32_t gap = 1, i, j, t;
+    for (i = 0; i < n; i++)
+	order[i] = i;
+    while(gap < n / 3)
+	gap = gap * 3 + 1;
+    for (; gap > 0; gap /= 3)
+	for (i = gap; i < n; i++) {
+	    t = order[i];
+	    for (j = i; j >= gap &&
+		     (key[order[j - gap]] > key[t] ||
+		      (key[order[j - gap]] == key[t] && order[j - gap] > t));
+		 j -= gap)
+		order[j] = order[j - gap];
+	    order[j] = t;
+	}
+}
+//write run of n items from tmp, item_stride() bytes each, from index first
+static LDB_RES write_run(LighDB *db, uint32_t first, uint32_t n, uint8_t *tmp)
+{
+    uint32_t bw, len = (n - 1) * item_stride(db) + row_size(db);
+    if(ldb_io_lseek(db->pfile_data,
+		    db->data_offset + item_stride(db) * first, SEEK_SET) ||
+       ldb_io_write(db->pfile_data, tmp, len, &bw) || bw != len)
+	return LDB_ERR_IO;
+    return LDB_OK;
+}
+//update n items in order of their indexes ind. Item k is items + k * item size.
+//Neighbour items are collected in tmp of cap items and written at once. Mutex must be taken
+static LDB_RES upd_sorted(LighDB *db, uint32_t *ind, uint8_t *items,
+			  uint32_t n, uint32_t *order,
+			  uint8_t *tmp, uint32_t cap)
+{
+    LDB_RES r;
+    uint32_t k, index, first = 0, run = 0;
+    uint32_t isize = db->h.item_size, stride = item_stride(db);
+    uint8_t *item, *row;
+    sort_by_key(order, n, ind);
+#if LDB_PAX
+    //fields of items are in different places, so items are written one by one
+    if(db->h.flags & LDB_F_PAX)
+	cap = 0;
+#endif
+    for (k = 0; k < n; k++) {
+	index = ind[order[k]];
+	item = items + order[k] * isize;
+	if((r = snapshots_save(db, index)))
+	    return r;
+	if(cap == 0)
+	{
+	    if((r = write_item(db, index, item)))
+		return r;
+	    continue;
+	}
+	//the same item again replaces previous data in run
+	if(run != 0 && index == first + run - 1)
+	    run --;
+	else if(run == 0 || index != first + run || run == cap)
+	{
+	    if(run != 0 && (r = write_run(db, first, run, tmp)))
+		return r;
+	    first = index;
+	    run = 0;
+	}
+	row = tmp + run * stride;
+	memcpy(row, item, isize);
+#if LDB_CRC
+	if(db->h.flags & LDB_F_CRC)
+	{
+	    uint32_t crc = crc32c(0, item, isize);
+	    memcpy(row + isize, &crc, 4);
+	}
+#endif
+	memset(row + row_size(db), 0, stride - row_size(db));
+	run ++;
+    }
+    if(run != 0 && (r = write_run(db, first, run, tmp)))
+	return r;
+    //changes are logged after they are written
+    for (k = 0; k < n; k++)
+	if((r = log_append(db, LDB_CHANGE_UPD, ind[order[k]], 0,
+			   items + order[k] * isize, isize)))
+	    return r;
+    return LDB_OK;
+}
+LDB_RES ldb_upd_many_ind(LighDB *db, uint32_t *indexes,
+			 void *items, uint32_t count, uint32_t size)
+{
+    LDB_RES r;
+    if(indexes == 0 || items == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))              //reQuest MUTEX
+	return r;
+    uint32_t i, n, stride = item_stride(db);
+    if(size / db->h.item_size < count)
+	r = LDB_ERR_SMALL_BUFFER;
+    for (i = 0; i < count && r == LDB_OK; i++)
+	if(indexes[i] >= db->h.count)
+	    r = LDB_BIG_INDEX;
+    //buffer: |order of batch|items of batch in order of indexes|
+    n = db->buffer_id_size * 4 / (4 + stride);
+    if(r == LDB_OK && n == 0 && count != 0)
+	r = LDB_ERR_SMALL_BUFFER;
+    db->buffer_id_count = 0;
+    for (i = 0; i < count && r == LDB_OK; i += n) {
+	if(n > count - i)
+	    n = count - i;
+	r = upd_sorted(db, indexes + i,
+		       (uint8_t*)items + i * db->h.item_size, n,
+		       db->buffer_id, (uint8_t*)(db->buffer_id + n), n);
+    }
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+//find index of first item for every of n IDs in one pass through ID table.
+//ind[k] is count if ids[k] isn't found. IDs are sorted in pos, table is read to sheet
+static LDB_RES find_many(LighDB *db, uint32_t *ids, uint32_t n,
+			 uint32_t *pos, uint32_t *ind,
+			 uint32_t *sheet, uint32_t sheet_size)
+{
+    LDB_RES r = LDB_OK;
+    uint32_t i, j, lo, hi, mid, id, left = n;
+    uint32_t *buffer = db->buffer_id, buffer_size = db->buffer_id_size;
+    sort_by_key(pos, n, ids);
+    for (i = 0; i < n; i++)
+	ind[i] = db->h.count;
+    //ID table is loaded to the rest of buffer
+    db->buffer_id = sheet;
+    db->buffer_id_size = sheet_size;
+    for (i = 0; i < db->h.count && left != 0 && r == LDB_OK;
+	 i += db->buffer_id_count) {
+	if((r = load_buf(db, i)))
+	    break;
+	for (j = 0; j < db->buffer_id_count && left != 0; j++) {
+	    id = db->buffer_id[j];
+	    //IDs after it are bigger than all searched
+	    if((db->h.flags & LDB_F_SORTED) && id > ids[pos[n - 1]])
+	    {
+		left = 0;
+		break;
+	    }
+	    //first searched ID >= id
+	    lo = 0;
+	    hi = n;
+	    while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if(ids[pos[mid]] < id)
+		    lo = mid + 1;
+		else
+		    hi = mid;
+	    }
+	    //every update of ID gets first item
+	    for (; lo < n && ids[pos[lo]] == id &&
+		     ind[pos[lo]] == db->h.count; lo++) {
+		ind[pos[lo]] = i + j;
+		left --;
+	    }
+	}
+    }
+    db->buffer_id = buffer;
+    db->buffer_id_size = buffer_size;
+    db->buffer_id_count = 0;
+    return r;
+}
+LDB_RES ldb_upd_many(LighDB *db, uint32_t *ids,
+		     void *items, uint32_t count, uint32_t size)
+{
+    LDB_RES r;
+    if(ids == 0 || items == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))              //reQuest MUTEX
+	return r;
+    uint32_t i, k, n, stride = item_stride(db);
+    if(size / db->h.item_size < count)
+	r = LDB_ERR_SMALL_BUFFER;
+    //buffer: |IDs order, then indexes order of batch|indexes of batch|
+    //ID table while IDs are searched, then items of batch in order of indexes|
+    //Page of ID table must fit after order and indexes
+    n = 0;
+    if(db->buffer_id_size > min_buf_size(db))
+	n = (db->buffer_id_size - min_buf_size(db)) * 4 / (8 + stride);
+    if(r == LDB_OK && n == 0 && count != 0)
+	r = LDB_ERR_SMALL_BUFFER;
+    for (i = 0; i < count && r == LDB_OK; i += n) {
+	if(n > count - i)
+	    n = count - i;
+	uint32_t *order = db->buffer_id, *ind = db->buffer_id + n;
+	uint32_t *rest = db->buffer_id + 2 * n;
+	if((r = find_many(db, ids + i, n, order, ind, rest,
+			  db->buffer_id_size - 2 * n)))
+	    break;
+	for (k = 0; k < n; k++)
+	    if(ind[k] == db->h.count)
+		r = LDB_ERR_NO_ID;
+	if(r == LDB_OK)
+	    r = upd_sorted(db, ind, (uint8_t*)items + i * db->h.item_size,
+			   n, order, (uint8_t*)rest, n);
+    }
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+#endif
 LDB_RES ldb_get_header(LighDB *db,
 		       uint8_t *buf, uint32_t size,
 		       uint32_t *read)
@@ -524,21 +2172,23 @@ LDB_RES ldb_get_header(LighDB *db,
     if(size > db->h.header_size)
 	size = db->h.header_size;
     //read user header
-    if(ldb_io_read(&db->file_index,
+    if(ldb_io_lseek(db->pfile_index,
+		    db->index_base + sysheader_size(db), SEEK_SET) ||
+       ldb_io_read(db->pfile_index,
 		    buf, size, &br)) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_IO;
     }
     //check read user header size
     if(size != br) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_IO;
     }
-    if(LDB_MUTEX_RELEASE(&db->mutex)) //reLease MUTEX
+    if(db_unlock(db)) //reLease MUTEX
 	return LDB_ERR_MUTEX;	
 
     if(read != 0)
-	*read = 0;
+	*read = size;
     
     return LDB_OK;
 }
@@ -555,17 +2205,23 @@ LDB_RES ldb_set_header(LighDB *db, uint8_t *buf, uint32_t size, uint32_t *writte
     if(size > db->h.header_size)
 	size = db->h.header_size;
     //write user header
-    if(ldb_io_write(&db->file_index,
+    if(ldb_io_lseek(db->pfile_index,
+		    db->index_base + sysheader_size(db), SEEK_SET) ||
+       ldb_io_write(db->pfile_index,
 		    buf, size, &bw)) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_IO;
     }
     //check written user header size
     if(size != bw) {
-	LDB_MUTEX_RELEASE(&db->mutex);//reLease MUTEX
+	db_unlock(db);//reLease MUTEX
 	return LDB_ERR_IO;
     }
-    if(LDB_MUTEX_RELEASE(&db->mutex)) //reLease MUTEX
+    if((r = log_append(db, LDB_CHANGE_HEADER, 0, 0, buf, size))) {
+	db_unlock(db);//reLease MUTEX
+	return r;
+    }
+    if(db_unlock(db)) //reLease MUTEX
 	return LDB_ERR_MUTEX;	
 
     if(written != 0)
@@ -574,6 +2230,1278 @@ LDB_RES ldb_set_header(LighDB *db, uint8_t *buf, uint32_t size, uint32_t *writte
     return LDB_OK;
 }
 #endif
+//compare field of n items with value and put result in mask
+#define LDB_CMP_ITEMS(T, OP)						\
+    for (i = 0; i < n; i++) {						\
+	T v;								\
+	memcpy(&v, items + i * stride, sizeof(T));			\
+	mask[i] = (v OP ref);						\
+    }
+#define LDB_CMP_TYPE(T) {						\
+	T ref;								\
+	memcpy(&ref, pred->value, sizeof(T));				\
+	switch(pred->op) {						\
+	case LDB_EQ: LDB_CMP_ITEMS(T, ==) break;			\
+	case LDB_NE: LDB_CMP_ITEMS(T, !=) break;			\
+	case LDB_LT: LDB_CMP_ITEMS(T, <)  break;			\
+	case LDB_LE: LDB_CMP_ITEMS(T, <=) break;			\
+	case LDB_GT: LDB_CMP_ITEMS(T, >)  break;			\
+	case LDB_GE: LDB_CMP_ITEMS(T, >=) break;			\
+	}								\
+    }
+static void cmp_items(LDB_PRED *pred, uint8_t *items, uint32_t offset,
+		      uint32_t stride, uint32_t n, uint8_t *mask)
+{
+    uint32_t i;
+    //every loop has fixed type and operation so compiler can vectorize it
+    items += offset;
+    switch(pred->type) {
+    case LDB_T_U8:  LDB_CMP_TYPE(uint8_t)  break;
+    case LDB_T_U16: LDB_CMP_TYPE(uint16_t) break;
+    case LDB_T_U32: LDB_CMP_TYPE(uint32_t) break;
+    case LDB_T_U64: LDB_CMP_TYPE(uint64_t) break;
+    case LDB_T_I8:  LDB_CMP_TYPE(int8_t)   break;
+    case LDB_T_I16: LDB_CMP_TYPE(int16_t)  break;
+    case LDB_T_I32: LDB_CMP_TYPE(int32_t)  break;
+    case LDB_T_I64: LDB_CMP_TYPE(int64_t)  break;
+    case LDB_T_F32: LDB_CMP_TYPE(float)    break;
+    case LDB_T_F64: LDB_CMP_TYPE(double)   break;
+    case LDB_T_BYTES:
+    default:
+	for (i = 0; i < n; i++) {
+	    int c = memcmp(items + i * stride, pred->value, pred->len);
+	    switch(pred->op) {
+	    case LDB_EQ: mask[i] = (c == 0); break;
+	    case LDB_NE: mask[i] = (c != 0); break;
+	    case LDB_LT: mask[i] = (c < 0);  break;
+	    case LDB_LE: mask[i] = (c <= 0); break;
+	    case LDB_GT: mask[i] = (c > 0);  break;
+	    case LDB_GE: mask[i] = (c >= 0); break;
+	    default:     mask[i] = 0;        break;
+	    }
+	}
+	break;
+    }
+}
+static uint32_t type_size(LDB_TYPE type)
+{
+    switch(type) {
+    case LDB_T_U8:
+    case LDB_T_I8:  return 1;
+    case LDB_T_U16:
+    case LDB_T_I16: return 2;
+    case LDB_T_U32:
+    case LDB_T_I32:
+    case LDB_T_F32: return 4;
+    case LDB_T_U64:
+    case LDB_T_I64:
+    case LDB_T_F64: return 8;
+    default:        return 0;
+    }
+}
+
+/**
+ * Chunk handler for stream_items. Called with mutex taken
+ *
+ * @param first index of first item in chunk
+ * @param items items one by one, or values of one field with LDB_F_PAX
+ * @param n count of items in chunk
+ * @param stride distance between items in chunk
+ * @return 0 to continue, other to stop streaming
+ */
+typedef uint8_t (*chunk_fn)(LighDB *db, uint32_t first,
+			    uint8_t *items, uint32_t n, uint32_t stride,
+			    void *arg);
+//put old versions of items saved in snapshot to chunk.
+//If col != 0 then chunk has only values of this field
+static LDB_RES snapshot_patch(LDB_SNAPSHOT *snap, uint32_t first,
+			      uint8_t *items, uint32_t n, uint32_t stride,
+			      LDB_FIELD *col)
+{
+    uint32_t i, ind, isize = snap->db->h.item_size;
+    uint32_t offset = (col != 0) ? col->offset : 0;
+    uint32_t len = (col != 0) ? col->len : isize;
+    if(snap->overflow)
+	return LDB_ERR_SNAPSHOT;
+    for (i = 0; i < snap->undo_count; i++) {
+	uint8_t *e = snap->undo + i * (4 + isize);
+	memcpy(&ind, e, 4);
+	if(ind >= first && ind - first < n)
+	    memcpy(items + (ind - first) * stride, e + 4 + offset, len);
+    }
+    return LDB_OK;
+}
+//read items [from; to) sequentially in chunks of buffer size and pass them to fn.
+//If col != 0 then only values of this field of LDB_F_PAX are read, and there is
+//room for one item after them in buffer.
+//If snap != 0 then items are as they were at snapshot begin
+static LDB_RES stream_items(LighDB *db, LDB_SNAPSHOT *snap,
+			    uint32_t from, uint32_t to, LDB_FIELD *col,
+			    chunk_fn fn, void *arg)
+{
+    LDB_RES r;
+    uint32_t n, stride;
+    uint8_t *items;
+    while(from < to) {
+	if((r = chk_db(db)))              //reQuest MUTEX
+	    return r;
+	items = (uint8_t*)db->buffer_id;
+	//how many items fit in buffer
+	stride = (col != 0) ? col->len : item_stride(db);
+	if(col == 0)
+	    n = chunk_items(db);
+	else if(db->buffer_id_size * 4 > db->h.item_size)
+	    n = (db->buffer_id_size * 4 - db->h.item_size) / stride;
+	else
+	    n = 0;
+	if(n == 0)
+	{
+	    db_unlock(db);//reLease MUTEX
+	    return LDB_ERR_SMALL_BUFFER;
+	}
+	if(n > to - from)
+	    n = to - from;
+#if LDB_PAX
+	if(col != 0)
+	{
+	    db->buffer_id_count = 0;
+	    r = pax_read_field(db, col, from, n, items);
+	}
+	else
+#endif
+	    r = read_items(db, from, n, 0);
+	if(r)
+	{
+	    db_unlock(db);//reLease MUTEX
+	    return r;
+	}
+	if(snap != 0 &&
+	   (r = snapshot_patch(snap, from, items, n, stride, col)))
+	{
+	    db_unlock(db);//reLease MUTEX
+	    return r;
+	}
+	if(fn(db, from, items, n, stride, arg))
+	    to = from; //stop
+	from += n;
+	if(db_unlock(db)) //reLease MUTEX
+	    return LDB_ERR_MUTEX;
+    }
+    return LDB_OK;
+}
+
+typedef struct {
+    LDB_PRED *pred;
+    ldb_scan_fn callback;
+    void *arg;
+    uint32_t offset;     //offset of compared field in streamed items
+    LDB_FIELD *col;      //only this field is streamed, or 0
+    LDB_SNAPSHOT *snap;
+    LDB_RES r;
+} scan_arg;
+#define LDB_SCAN_BATCH 64
+#if LDB_PAX
+//pass found items to callback when only compared field was streamed.
+//Items are read after field values in buffer
+static uint8_t scan_found(LighDB *db, scan_arg *s, uint32_t first,
+			  uint8_t *mask, uint32_t n)
+{
+    uint32_t i, sz = db->h.item_size;
+    uint8_t *item = (uint8_t*)db->buffer_id + db->buffer_id_size * 4 - sz;
+    for (i = 0; i < n; i++) {
+	if(mask[i] == 0)
+	    continue;
+	if((s->r = read_item(db, first + i, item)) ||
+	   (s->snap != 0 &&
+	    (s->r = snapshot_patch(s->snap, first + i, item, 1, sz, 0))))
+	    return 1;
+	if(s->callback(first + i, item, sz, s->arg))
+	    return 1;
+    }
+    return 0;
+}
+#endif
+static uint8_t scan_chunk(LighDB *db, uint32_t first,
+			  uint8_t *items, uint32_t n, uint32_t st, void *arg)
+{
+    scan_arg *s = (scan_arg*)arg;
+    uint32_t sz = db->h.item_size;
+    uint8_t mask[LDB_SCAN_BATCH];
+    uint32_t i, b, bn;
+
+    for (b = 0; b < n; b += bn) {
+	bn = n - b;
+	if(bn > LDB_SCAN_BATCH)
+	    bn = LDB_SCAN_BATCH;
+	//evaluate predicate for whole batch in place
+	if(s->pred == 0)
+	    memset(mask, 1, bn);
+	else if(s->pred->fn != 0)
+	    for (i = 0; i < bn; i++)
+		mask[i] = s->pred->fn(items + (b + i) * st, sz, s->pred->arg);
+	else
+	    cmp_items(s->pred, items + b * st, s->offset, st, bn, mask);
+
+#if LDB_PAX
+	if(s->col != 0)
+	{
+	    if(scan_found(db, s, first + b, mask, bn))
+		return 1;
+	    continue;
+	}
+#endif
+	for (i = 0; i < bn; i++)
+	    if(mask[i] &&
+	       s->callback(first + b + i, items + (b + i) * st, sz, s->arg))
+		return 1;
+    }
+    return 0;
+}
+static LDB_RES scan_items(LighDB *db, LDB_SNAPSHOT *snap,
+			  LDB_PRED *pred,
+			  ldb_scan_fn callback, void *arg)
+{
+    LDB_RES r;
+    if(callback == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(pred != 0 && pred->fn == 0 && pred->value == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))              //reQuest MUTEX
+	return r;
+    //check that compared field is inside of item
+    uint32_t flen = 0;
+    if(pred != 0 && pred->fn == 0)
+	flen = (pred->type == LDB_T_BYTES) ? pred->len : type_size(pred->type);
+    if(pred != 0 && pred->fn == 0 &&
+       (flen == 0 || pred->offset + flen > db->h.item_size))
+    {
+	db_unlock(db);//reLease MUTEX
+	return LDB_ERR;
+    }
+    //items added during scan are not visited
+    uint32_t count = (snap != 0) ? snap->count : db->h.count;
+    scan_arg s = {pred, callback, arg, 0, 0, snap, LDB_OK};
+#if LDB_PAX
+    //with LDB_F_PAX only compared field is read for every item
+    if(flen != 0 && (s.col = pax_field(db, pred->offset, flen)) != 0)
+	s.offset = pred->offset - s.col->offset;
+    else
+#endif
+    if(pred != 0)
+	s.offset = pred->offset;
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+
+    if((r = stream_items(db, snap, 0, count, s.col, scan_chunk, &s)))
+	return r;
+    return s.r;
+}
+LDB_RES ldb_scan(LighDB *db, LDB_PRED *pred,
+		 ldb_scan_fn callback, void *arg)
+{
+    return scan_items(db, 0, pred, callback, arg);
+}
+
+typedef struct {
+    uint32_t offset;
+    LDB_TYPE type;
+    LDB_AGG op;
+    LDB_AGG_RES *res;
+} agg_arg;
+//reduce field of n items. Local accumulator lets compiler vectorize the loop
+#define LDB_AGG_ITEMS(T, ACC, FIELD) {					\
+	ACC acc;							\
+	T v;								\
+	uint32_t i;							\
+	switch(a->op) {							\
+	case LDB_AGG_SUM:						\
+	    acc = 0;							\
+	    for (i = 0; i < n; i++) {					\
+		memcpy(&v, items + i * stride, sizeof(T));		\
+		acc += v;						\
+	    }								\
+	    a->res->v.FIELD += acc;					\
+	    break;							\
+	case LDB_AGG_MIN:						\
+	    memcpy(&v, items, sizeof(T));				\
+	    acc = (a->res->count == 0 || v < a->res->v.FIELD) ?	\
+		v : a->res->v.FIELD;					\
+	    for (i = 1; i < n; i++) {					\
+		memcpy(&v, items + i * stride, sizeof(T));		\
+		acc = v < acc ? v : acc;				\
+	    }								\
+	    a->res->v.FIELD = acc;					\
+	    break;							\
+	case LDB_AGG_MAX:						\
+	    memcpy(&v, items, sizeof(T));				\
+	    acc = (a->res->count == 0 || v > a->res->v.FIELD) ?	\
+		v : a->res->v.FIELD;					\
+	    for (i = 1; i < n; i++) {					\
+		memcpy(&v, items + i * stride, sizeof(T));		\
+		acc = v > acc ? v : acc;				\
+	    }								\
+	    a->res->v.FIELD = acc;					\
+	    break;							\
+	default:							\
+	    break;							\
+	}								\
+    }
+static uint8_t agg_chunk(LighDB *db, uint32_t first,
+			 uint8_t *items, uint32_t n, uint32_t stride,
+			 void *arg)
+{
+    agg_arg *a = (agg_arg*)arg;
+    (void)db;
+    (void)first;
+    items += a->offset;
+    switch(a->type) {
+    case LDB_T_U8:  LDB_AGG_ITEMS(uint8_t,  uint64_t, u) break;
+    case LDB_T_U16: LDB_AGG_ITEMS(uint16_t, uint64_t, u) break;
+    case LDB_T_U32: LDB_AGG_ITEMS(uint32_t, uint64_t, u) break;
+    case LDB_T_U64: LDB_AGG_ITEMS(uint64_t, uint64_t, u) break;
+    case LDB_T_I8:  LDB_AGG_ITEMS(int8_t,   int64_t,  i) break;
+    case LDB_T_I16: LDB_AGG_ITEMS(int16_t,  int64_t,  i) break;
+    case LDB_T_I32: LDB_AGG_ITEMS(int32_t,  int64_t,  i) break;
+    case LDB_T_I64: LDB_AGG_ITEMS(int64_t,  int64_t,  i) break;
+    case LDB_T_F32: LDB_AGG_ITEMS(float,    double,   f) break;
+    case LDB_T_F64: LDB_AGG_ITEMS(double,   double,   f) break;
+    default: break;
+    }
+    a->res->count += n;
+    return 0;
+}
+static LDB_RES aggregate(LighDB *db, LDB_SNAPSHOT *snap,
+			 uint32_t offset,
+			 LDB_TYPE type, LDB_AGG op,
+			 uint32_t from, uint32_t to,
+			 LDB_AGG_RES *out)
+{
+    LDB_RES r;
+    if(out == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))              //reQuest MUTEX
+	return r;
+    uint32_t flen = type_size(type);
+    if(flen == 0 || offset + flen > db->h.item_size)
+    {
+	db_unlock(db);//reLease MUTEX
+	return LDB_ERR;
+    }
+    if(snap != 0 && to > snap->count)
+	to = snap->count;
+    if(to > db->h.count)
+	to = db->h.count;
+    LDB_FIELD *col = 0;
+#if LDB_PAX
+    //with LDB_F_PAX only aggregated field is read
+    if((col = pax_field(db, offset, flen)) != 0)
+	offset -= col->offset;
+#endif
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+
+    out->count = 0;
+    out->v.u = 0;
+    if(type == LDB_T_F32 || type == LDB_T_F64)
+	out->v.f = 0;
+    if(op == LDB_AGG_COUNT)
+    {
+	//field isn't needed to count, so don't read data
+	if(from < to)
+	    out->count = to - from;
+	return LDB_OK;
+    }
+    agg_arg a = {offset, type, op, out};
+    return stream_items(db, snap, from, to, col, agg_chunk, &a);
+}
+LDB_RES ldb_aggregate(LighDB *db, uint32_t offset,
+		      LDB_TYPE type, LDB_AGG op,
+		      uint32_t from, uint32_t to,
+		      LDB_AGG_RES *out)
+{
+    return aggregate(db, 0, offset, type, op, from, to, out);
+}
+void ldb_aggregate_merge(LDB_TYPE type, LDB_AGG op,
+			 LDB_AGG_RES *out, LDB_AGG_RES *part)
+{
+    if(out == 0 || part == 0 || part->count == 0)
+	return;
+    uint8_t is_float = (type == LDB_T_F32 || type == LDB_T_F64);
+    uint8_t is_signed = (type >= LDB_T_I8 && type <= LDB_T_I64);
+    uint8_t less;
+    switch(op) {
+    case LDB_AGG_SUM:
+	if(is_float)
+	    out->v.f += part->v.f;
+	else
+	    out->v.u += part->v.u; //same bits for signed
+	break;
+    case LDB_AGG_MIN:
+    case LDB_AGG_MAX:
+	if(is_float)
+	    less = part->v.f < out->v.f;
+	else if(is_signed)
+	    less = part->v.i < out->v.i;
+	else
+	    less = part->v.u < out->v.u;
+	if(out->count == 0 || (op == LDB_AGG_MIN ? less : !less))
+	    out->v = part->v;
+	break;
+    default:
+	break;
+    }
+    out->count += part->count;
+}
+LDB_RES ldb_snapshot_begin(LighDB *db, LDB_SNAPSHOT *snap,
+			   uint8_t *undo, uint32_t undo_size)
+{
+    if(db == 0 || snap == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(db_lock(db))  //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    if(db->opened == 0)
+    {
+	db_unlock(db); //reLease MUTEX
+	return LDB_ERR_NOT_OPENED;
+    }
+    snap->db = db;
+    snap->count = db->h.count;
+    snap->undo = undo;
+    snap->undo_size = (undo != 0) ? undo_size : 0;
+    snap->undo_count = 0;
+    snap->overflow = 0;
+    //add to list of active snapshots
+    snap->next = db->snapshots;
+    db->snapshots = snap;
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+LDB_RES ldb_snapshot_end(LDB_SNAPSHOT *snap)
+{
+    if(snap == 0 || snap->db == 0)
+	return LDB_ERR_ZERO_POINTER;
+    LighDB *db = snap->db;
+    if(db_lock(db))  //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    //remove from list of active snapshots
+    LDB_SNAPSHOT **p;
+    for (p = &db->snapshots; *p != 0; p = &(*p)->next)
+	if(*p == snap)
+	{
+	    *p = snap->next;
+	    break;
+	}
+    snap->db = 0;
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+LDB_RES ldb_snapshot_get_ind(LDB_SNAPSHOT *snap, uint32_t index,
+			     uint8_t *buf, uint32_t size)
+{
+    LDB_RES r;
+    if(snap == 0 || buf == 0)
+	return LDB_ERR_ZERO_POINTER;
+    LighDB *db = snap->db;
+    if((r = chk_db(db)))              //reQuest MUTEX
+	return r;
+    if(size < db->h.item_size)
+    {
+	db_unlock(db);//reLease MUTEX
+	return LDB_ERR_SMALL_BUFFER;
+    }
+    if(index >= snap->count)
+    {
+	db_unlock(db);//reLease MUTEX
+	return LDB_BIG_INDEX;
+    }
+    r = read_item(db, index, buf);
+    if(r == LDB_OK)
+	r = snapshot_patch(snap, index, buf, 1, db->h.item_size, 0);
+    if(db_unlock(db)) //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+LDB_RES ldb_snapshot_scan(LDB_SNAPSHOT *snap, LDB_PRED *pred,
+			  ldb_scan_fn callback, void *arg)
+{
+    if(snap == 0)
+	return LDB_ERR_ZERO_POINTER;
+    return scan_items(snap->db, snap, pred, callback, arg);
+}
+LDB_RES ldb_snapshot_aggregate(LDB_SNAPSHOT *snap, uint32_t offset,
+			       LDB_TYPE type, LDB_AGG op,
+			       uint32_t from, uint32_t to,
+			       LDB_AGG_RES *out)
+{
+    if(snap == 0)
+	return LDB_ERR_ZERO_POINTER;
+    return aggregate(snap->db, snap, offset, type, op, from, to, out);
+}
+#if LDB_CHANGELOG
+LDB_RES ldb_changelog_open(LighDB *db, char *path, uint8_t create)
+{
+    if(db == 0 || path == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(db_lock(db))  //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    if(db->opened == 0)
+    {
+	db_unlock(db); //reLease MUTEX
+	return LDB_ERR_NOT_OPENED;
+    }
+    if(db->log_opened)
+	ldb_io_close(&db->file_log);
+    db->log_opened = 0;
+    if(ldb_io_open(&db->file_log, path, create))
+    {
+	db_unlock(db); //reLease MUTEX
+	return LDB_ERR_IO;
+    }
+    LDB_RES r = LDB_OK;
+    uint32_t br;
+    uint8_t buf[10];
+    db->log_seq = 0;
+    db->log_size = 10;
+    db->log_hint_seq = 0;
+    db->log_hint_pos = 0;
+    if(create)
+    {
+	//write version in log file
+	if(ldb_io_write(&db->file_log, (uint8_t*)ldb_ver, 10, &br))
+	    r = LDB_ERR_IO;
+    }
+    else if(ldb_io_read(&db->file_log, buf, 10, &br) || br != 10)
+	r = LDB_ERR_IO;
+    else if(memcmp(buf, ldb_ver, 6) != 0)
+	r = LDB_ERR_HEADER;
+    else
+    {
+	//find last complete change. Torn record at the end is overwritten
+	LDB_CHANGE ch;
+	while(ldb_io_lseek(&db->file_log, db->log_size, SEEK_SET) == LDB_OK &&
+	      ldb_io_read(&db->file_log, (uint8_t*)&ch, sizeof(ch), &br) == LDB_OK &&
+	      br == sizeof(ch) &&
+	      ch.seq == db->log_seq + 1)
+	{
+	    if(ch.size != 0 &&
+	       (ldb_io_lseek(&db->file_log,
+			     db->log_size + sizeof(ch) + ch.size - 1,
+			     SEEK_SET) ||
+		ldb_io_read(&db->file_log, buf, 1, &br)))
+		break;
+	    db->log_seq = ch.seq;
+	    db->log_size += sizeof(ch) + ch.size;
+	}
+    }
+    if(r)
+	ldb_io_close(&db->file_log);
+    else
+	db->log_opened = 1;
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+LDB_RES ldb_changelog_close(LighDB *db)
+{
+    if(db == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(db_lock(db))  //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    LDB_RES r = LDB_OK;
+    if(db->log_opened == 0)
+	r = LDB_ERR_NOT_OPENED;
+    else if(ldb_io_close(&db->file_log))
+	r = LDB_ERR_IO;
+    db->log_opened = 0;
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+LDB_RES ldb_changes_since(LighDB *db, uint32_t seq,
+			  ldb_change_fn callback, void *arg)
+{
+    LDB_RES r;
+    if(callback == 0)
+	return LDB_ERR_ZERO_POINTER;
+    uint32_t pos = 0, br;
+    LDB_CHANGE ch;
+    while(1) {
+	if((r = chk_db(db)))              //reQuest MUTEX
+	    return r;
+	if(db->log_opened == 0)
+	    r = LDB_ERR_NOT_OPENED;
+	if(pos == 0)
+	{
+	    //skip changes which were already read by previous call
+	    pos = 10;
+	    if(db->log_hint_pos != 0 && seq >= db->log_hint_seq)
+		pos = db->log_hint_pos;
+	}
+	if(r || pos >= db->log_size)
+	{
+	    db_unlock(db);//reLease MUTEX
+	    return r;
+	}
+	if(ldb_io_lseek(&db->file_log, pos, SEEK_SET) ||
+	   ldb_io_read(&db->file_log, (uint8_t*)&ch, sizeof(ch), &br) ||
+	   br != sizeof(ch))
+	    r = LDB_ERR_IO;
+	else if(ch.size > db->buffer_id_size * 4)
+	    r = LDB_ERR_SMALL_BUFFER;
+	else if(ch.seq > seq)
+	{
+	    //buffer is overwritten, so ID table in it is not valid anymore
+	    db->buffer_id_count = 0;
+	    if(ch.size != 0 &&
+	       (ldb_io_read(&db->file_log, (uint8_t*)db->buffer_id,
+			    ch.size, &br) ||
+		br != ch.size))
+		r = LDB_ERR_IO;
+	    else if(callback(&ch, (uint8_t*)db->buffer_id, arg))
+		pos = db->log_size; //stop
+	}
+	if(r == LDB_OK && pos < db->log_size)
+	{
+	    pos += sizeof(ch) + ch.size;
+	    db->log_hint_seq = ch.seq;
+	    db->log_hint_pos = pos;
+	}
+	if(db_unlock(db)) //reLease MUTEX
+	    return LDB_ERR_MUTEX;
+	if(r)
+	    return r;
+    }
+}
+LDB_RES ldb_apply_change(LighDB *db, LDB_CHANGE *ch, uint8_t *data)
+{
+    if(db == 0 || ch == 0 || data == 0)
+	return LDB_ERR_ZERO_POINTER;
+    switch(ch->op) {
+    case LDB_CHANGE_ADD:
+	//follower must have the same items as leader before the change
+	if(ch->index != db->h.count)
+	    return LDB_ERR;
+	return ldb_add(db, data, ch->size, ch->id, 0);
+    case LDB_CHANGE_UPD:
+	return ldb_upd_ind(db, ch->index, data, ch->size);
+    case LDB_CHANGE_HEADER:
+	return ldb_set_header(db, data, ch->size, 0);
+    default:
+	return LDB_ERR;
+    }
+}
+typedef struct {
+    LighDB *follower;
+    LDB_RES r;
+    uint32_t last;
+} apply_arg;
+static uint8_t apply_cb(LDB_CHANGE *ch, uint8_t *data, void *arg)
+{
+    apply_arg *a = (apply_arg*)arg;
+    if((a->r = ldb_apply_change(a->follower, ch, data)))
+	return 1;
+    a->last = ch->seq;
+    return 0;
+}
+LDB_RES ldb_apply_changes(LighDB *leader, LighDB *follower,
+			  uint32_t seq, uint32_t *last)
+{
+    LDB_RES r;
+    if(leader == 0 || follower == 0)
+	return LDB_ERR_ZERO_POINTER;
+    //follower is changed while mutex of leader is taken
+    if(follower->pmutex == leader->pmutex)
+	return LDB_ERR;
+    apply_arg a = {follower, LDB_OK, seq};
+    r = ldb_changes_since(leader, seq, apply_cb, &a);
+    if(last != 0)
+	*last = a.last;
+    if(r)
+	return r;
+    return a.r;
+}
+#endif
+#if LDB_SUMMARY
+//write summary of all ID table. Mutex must be taken
+static LDB_RES sum_build(LighDB *db)
+{
+    uint8_t bloom[LDB_SUMMARY_BLOOM];
+    uint32_t hdr[3] = {LDB_SUMMARY_IDS, LDB_SUMMARY_BLOOM, 0};
+    uint32_t mm[2] = {0, 0}, ind = 0, i, h, bw;
+    LDB_RES r;
+    if(ldb_io_lseek(&db->file_sum, 0, SEEK_SET) ||
+       ldb_io_write(&db->file_sum, (uint8_t*)ldb_sum_ver, 10, &bw) ||
+       ldb_io_write(&db->file_sum, (uint8_t*)hdr, 12, &bw))
+	return LDB_ERR_IO;
+    db->sum_count = 0;
+    while(ind < db->h.count) {
+	//sheets are loaded from page starts, so page is in one sheet or continues in next
+	if((r = load_buf(db, ind)))
+	    return r;
+	for (i = 0; i < db->buffer_id_count; i++, ind++) {
+	    if(ind % LDB_SUMMARY_IDS == 0)
+	    {
+		memset(bloom, 0, sizeof(bloom));
+		mm[0] = mm[1] = db->buffer_id[i];
+	    }
+	    if(db->buffer_id[i] < mm[0])
+		mm[0] = db->buffer_id[i];
+	    if(db->buffer_id[i] > mm[1])
+		mm[1] = db->buffer_id[i];
+	    h = sum_hash(db->buffer_id[i]);
+	    bloom[(h % SUM_BITS) / 8] |= 1 << (h % 8);
+	    bloom[((h >> 16) % SUM_BITS) / 8] |= 1 << ((h >> 16) % 8);
+	    //write page when it is over
+	    if((ind + 1) % LDB_SUMMARY_IDS == 0 || ind + 1 == db->h.count)
+	    {
+		if(ldb_io_lseek(&db->file_sum,
+				SUM_HEADER + ind / LDB_SUMMARY_IDS * SUM_ENTRY,
+				SEEK_SET) ||
+		   ldb_io_write(&db->file_sum, (uint8_t*)mm, 8, &bw) ||
+		   ldb_io_write(&db->file_sum, bloom, sizeof(bloom), &bw) ||
+		   bw != sizeof(bloom))
+		    return LDB_ERR_IO;
+	    }
+	}
+    }
+    if((r = sum_write_count(db, db->h.count)))
+	return r;
+    db->sum_count = db->h.count;
+    return LDB_OK;
+}
+LDB_RES ldb_summary_open(LighDB *db, char *path, uint8_t create)
+{
+    LDB_RES r;
+    if(path == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_db(db)))  //reQuest MUTEX
+	return r;
+    if(db->sum_opened)
+	ldb_io_close(&db->file_sum);
+    db->sum_opened = 0;
+    if(ldb_io_open(&db->file_sum, path, create))
+    {
+	db_unlock(db); //reLease MUTEX
+	return LDB_ERR_IO;
+    }
+    uint8_t ver[10];
+    uint32_t hdr[3] = {0, 0, 0}, br;
+    if(create == 0 &&
+       (ldb_io_read(&db->file_sum, ver, 10, &br) || br != 10 ||
+	memcmp(ver, ldb_sum_ver, 10) != 0 ||
+	ldb_io_read(&db->file_sum, (uint8_t*)hdr, 12, &br) || br != 12))
+	hdr[0] = 0;
+    //summary of other layout or other count of items is rebuilt
+    if(hdr[0] == LDB_SUMMARY_IDS && hdr[1] == LDB_SUMMARY_BLOOM &&
+       hdr[2] == db->h.count)
+    {
+	db->sum_count = hdr[2];
+	r = LDB_OK;
+    }
+    else
+	r = sum_build(db);
+    if(r)
+	ldb_io_close(&db->file_sum);
+    else
+	db->sum_opened = 1;
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+LDB_RES ldb_summary_close(LighDB *db)
+{
+    if(db == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(db_lock(db))  //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    LDB_RES r = LDB_OK;
+    if(db->sum_opened == 0)
+	r = LDB_ERR_NOT_OPENED;
+    else if(ldb_io_close(&db->file_sum))
+	r = LDB_ERR_IO;
+    db->sum_opened = 0;
+    if(db_unlock(db))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+#endif
+#if LDB_CRC
+LDB_RES ldb_verify(LighDB *db, uint32_t *bad)
+{
+    LDB_RES r;
+    uint32_t from, n, count;
+    if((r = chk_db(db)))                  //reQuest MUTEX
+	return r;
+    count = db->h.count;
+    if((db->h.flags & LDB_F_CRC) == 0)
+	r = LDB_ERR;
+    if(db_unlock(db))     //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    if(r)
+	return r;
+    //check items
+    for (from = 0; from < count; from += n) {
+	if((r = chk_db(db)))              //reQuest MUTEX
+	    return r;
+	n = db->buffer_id_size * 4 / item_stride(db);
+	if(n > count - from)
+	    n = count - from;
+	if(n == 0)
+	    r = LDB_ERR_SMALL_BUFFER;
+	else
+	    r = read_items(db, from, n, bad);
+	if(db_unlock(db)) //reLease MUTEX
+	    return LDB_ERR_MUTEX;
+	if(r)
+	    return r;
+    }
+    //check pages of ID table
+    for (from = 0; from < count; from += n) {
+	if((r = chk_db(db)))              //reQuest MUTEX
+	    return r;
+	r = load_buf(db, from);
+	if(r == LDB_ERR_CRC && bad != 0)
+	    *bad = db->buffer_id_start_index;
+	n = db->buffer_id_count;
+	if(db_unlock(db)) //reLease MUTEX
+	    return LDB_ERR_MUTEX;
+	if(r)
+	    return r;
+    }
+    return LDB_OK;
+}
+#endif
+//set up DB as table of env. Mutex of env must be taken
+static void env_table(LighDBEnv *env, LighDB *db, LDB_ENV_TABLE *t)
+{
+    db->pfile_data = &env->file_data;
+    db->pfile_index = &env->file_index;
+    db->pmutex = &env->mutex;
+    db->env = env;
+    db->index_base = t->index_base;
+    db->capacity = t->capacity;
+    db->index_offset = align_up(db, t->index_base + sysheader_size(db) +
+				db->h.header_size);
+    db->data_offset = t->data_base;
+    db->buffer_id = env->buffer;
+    db->buffer_id_size = env->buffer_size;
+    db->buffer_id_count = 0;
+    db->snapshots = 0;
+#if LDB_CHANGELOG
+    db->log_opened = 0;
+#endif
+#if LDB_SUMMARY
+    db->sum_opened = 0;
+#endif
+    db->opened = 1;
+    env->tables_opened ++;
+}
+//find table in catalog. Catalog is read in chunks of buffer size. Mutex must be taken
+static LDB_RES env_find(LighDBEnv *env, char *name, LDB_ENV_TABLE *t)
+{
+    LDB_ENV_TABLE *cat = (LDB_ENV_TABLE*)env->buffer;
+    uint32_t size = env->buffer_size * 4 / sizeof(LDB_ENV_TABLE);
+    uint32_t i, n, br, from;
+    if(size == 0)
+	return LDB_ERR_SMALL_BUFFER;
+    //buffer is overwritten, so IDs of table in it are not valid anymore
+    env->buffer_owner = 0;
+    for (from = 0; from < env->h.tables; from += n) {
+	n = env->h.tables - from;
+	if(n > size)
+	    n = size;
+	if(ldb_io_lseek(&env->file_index,
+			sizeof(env->h) + from * sizeof(LDB_ENV_TABLE),
+			SEEK_SET) ||
+	   ldb_io_read(&env->file_index, (uint8_t*)cat,
+		       n * sizeof(LDB_ENV_TABLE), &br) ||
+	   br != n * sizeof(LDB_ENV_TABLE))
+	    return LDB_ERR_IO;
+	for (i = 0; i < n; i++)
+	    if(strncmp(cat[i].name, name, LDB_ENV_NAME_SIZE) == 0)
+	    {
+		memcpy(t, &cat[i], sizeof(*t));
+		return LDB_OK;
+	    }
+    }
+    return LDB_ERR_NO_ID;
+}
+inline static LDB_RES chk_env(LighDBEnv *env)
+{
+    if(env == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(LDB_MUTEX_REQUEST(&env->mutex)) //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    if(env->opened == 0)
+    {
+	LDB_MUTEX_RELEASE(&env->mutex);//reLease MUTEX
+	return LDB_ERR_NOT_OPENED;
+    }
+    if(env->buffer == 0)
+    {
+	LDB_MUTEX_RELEASE(&env->mutex);//reLease MUTEX
+	return LDB_ERR_NO_BUFFER;
+    }
+    return LDB_OK;
+}
+static LDB_RES env_init(LighDBEnv *env)
+{
+    env->opened = 1;
+    env->buffer = 0;
+    env->buffer_size = 0;
+    env->buffer_owner = 0;
+    env->tables_opened = 0;
+    if(LDB_MUTEX_CREATE(&env->mutex))
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+LDB_RES ldb_env_open(LighDBEnv *env, char *path_index, char *path_data)
+{
+    if(env == 0 || path_index == 0 || path_data == 0)
+	return LDB_ERR_ZERO_POINTER;
+    LDB_RES r = LDB_OK;
+    uint32_t br;
+    uint8_t buf[10];
+    //open index file and read env header
+    if(ldb_io_open(&env->file_index, path_index, 0))
+	return LDB_ERR_IO;
+    if(ldb_io_read(&env->file_index,
+		   (uint8_t*)&env->h, sizeof(env->h), &br) ||
+       br != sizeof(env->h))
+	r = LDB_ERR_IO;
+    else if(memcmp(env->h.version, ldb_env_ver, 7) != 0)
+	r = LDB_ERR_HEADER;
+    if(r) {
+	ldb_io_close(&env->file_index);
+	return r;
+    }
+    //open data file and check it
+    if(ldb_io_open(&env->file_data, path_data, 0)) {
+	ldb_io_close(&env->file_index);
+	return LDB_ERR_IO;
+    }
+    if(ldb_io_read(&env->file_data, buf, 10, &br) || br != 10)
+	r = LDB_ERR_IO;
+    else if(memcmp(buf, ldb_env_ver, 7) != 0)
+	r = LDB_ERR_HEADER;
+    if(r) {
+	ldb_io_close(&env->file_index);
+	ldb_io_close(&env->file_data);
+	return r;
+    }
+    return env_init(env);
+}
+#if !LDB_READ_ONLY
+static LDB_RES env_update_header(LighDBEnv *env)
+{
+    uint32_t bw;
+    if(ldb_io_lseek(&env->file_index, 0, SEEK_SET) ||
+       ldb_io_write(&env->file_index,
+		    (uint8_t*)&env->h, sizeof(env->h), &bw) ||
+       bw != sizeof(env->h))
+	return LDB_ERR_IO;
+    return LDB_OK;
+}
+LDB_RES ldb_env_create(LighDBEnv *env, char *path_index, char *path_data,
+		       uint32_t tables_max)
+{
+    if(env == 0 || path_index == 0 || path_data == 0)
+	return LDB_ERR_ZERO_POINTER;
+    uint32_t bw;
+    //tables are placed after catalog
+    memcpy(env->h.version, ldb_env_ver, 10);
+    env->h.tables_max = tables_max;
+    env->h.tables = 0;
+    env->h.index_end = sizeof(env->h) + tables_max * sizeof(LDB_ENV_TABLE);
+    env->h.data_end = 10;
+    if(ldb_io_open(&env->file_index, path_index, 1))
+	return LDB_ERR_IO;
+    if(env_update_header(env)) {
+	ldb_io_close(&env->file_index);
+	return LDB_ERR_IO;
+    }
+    if(ldb_io_open(&env->file_data, path_data, 1)) {
+	ldb_io_close(&env->file_index);
+	return LDB_ERR_IO;
+    }
+    //write version in data file
+    if(ldb_io_write(&env->file_data, (uint8_t*)ldb_env_ver, 10, &bw) ||
+       bw != 10) {
+	ldb_io_close(&env->file_index);
+	ldb_io_close(&env->file_data);
+	return LDB_ERR_IO;
+    }
+    return env_init(env);
+}
+#endif
+LDB_RES ldb_env_set_buffer(LighDBEnv *env, uint32_t *buffer, uint32_t size)
+{
+    if(env == 0 || buffer == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(size / 4 < LDB_MIN_ID_BUFF)
+	return LDB_ERR_SMALL_BUFFER;
+    if(LDB_MUTEX_REQUEST(&env->mutex))   //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    if(env->opened == 0)
+    {
+	LDB_MUTEX_RELEASE(&env->mutex);  //reLease MUTEX
+	return LDB_ERR_NOT_OPENED;
+    }
+    env->buffer = buffer;
+    env->buffer_size = size / 4;
+    env->buffer_owner = 0;
+    if(LDB_MUTEX_RELEASE(&env->mutex))   //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return LDB_OK;
+}
+LDB_RES ldb_env_close(LighDBEnv *env)
+{
+    if(env == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(LDB_MUTEX_REQUEST(&env->mutex))  //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    LDB_RES r = LDB_OK;
+    if(env->opened == 0)
+	r = LDB_ERR_NOT_OPENED;
+    else if(env->tables_opened != 0)
+	r = LDB_ERR;
+    if(r)
+    {
+	LDB_MUTEX_RELEASE(&env->mutex); //reLease MUTEX
+	return r;
+    }
+    env->opened = 0;
+    env->buffer = 0;
+    if(ldb_io_close(&env->file_index))
+	r = LDB_ERR_IO;
+    if(ldb_io_close(&env->file_data))
+	r = LDB_ERR_IO;
+    if(LDB_MUTEX_RELEASE(&env->mutex))  //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    if(LDB_MUTEX_DELETE(&env->mutex))
+	return LDB_ERR_MUTEX;
+    return r;
+}
+LDB_RES ldb_env_open_table(LighDBEnv *env, LighDB *db, char *name)
+{
+    LDB_RES r;
+    LDB_ENV_TABLE t;
+    uint32_t br;
+    if(db == 0 || name == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if((r = chk_env(env)))                //reQuest MUTEX
+	return r;
+    //catalog lookup and system header of table is all that is read
+    r = env_find(env, name, &t);
+    if(r == LDB_OK &&
+       (ldb_io_lseek(&env->file_index, t.index_base, SEEK_SET) ||
+	ldb_io_read(&env->file_index,
+		    (uint8_t*)&db->h, sizeof(db->h), &br) ||
+	br != sizeof(db->h)))
+	r = LDB_ERR_IO;
+    if(r == LDB_OK &&
+       (memcmp(db->h.version, ldb_ver, 6) != 0 ||
+	(db->h.flags & ~LDB_F_SUPPORTED) ||
+	(db->h.flags & (LDB_F_PAX | LDB_F_PACKED_IDS))))
+	r = LDB_ERR_HEADER;
+    if(r == LDB_OK && env->buffer_size < min_buf_size(db))
+	r = LDB_ERR_SMALL_BUFFER;
+    if(r == LDB_OK)
+    {
+	env_table(env, db, &t);
+	if((r = read_last_id(db)))
+	{
+	    db->opened = 0;
+	    env->tables_opened --;
+	}
+    }
+    if(LDB_MUTEX_RELEASE(&env->mutex))    //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+#if !LDB_READ_ONLY
+LDB_RES ldb_env_create_table(LighDBEnv *env, LighDB *db, char *name,
+			     uint32_t size,
+			     uint32_t header_size, uint8_t *header,
+			     uint32_t flags, uint32_t capacity)
+{
+    LDB_RES r;
+    LDB_ENV_TABLE t;
+    uint32_t bw, ids;
+    if(db == 0 || name == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(size == 0 || capacity == 0 || strlen(name) >= LDB_ENV_NAME_SIZE)
+	return LDB_ERR;
+    //items and IDs of tables are one by one in env files
+    if((flags & ~LDB_F_SUPPORTED) || (flags & (LDB_F_PAX | LDB_F_PACKED_IDS)) ||
+       ((flags & LDB_F_ALIGN_ROWS) && !(flags & LDB_F_ALIGNED)))
+	return LDB_ERR_HEADER;
+    if((r = chk_env(env)))                //reQuest MUTEX
+	return r;
+    if(env->h.tables >= env->h.tables_max)
+	r = LDB_ERR_FULL;
+    else if((r = env_find(env, name, &t)) == LDB_OK)
+	r = LDB_ERR; //name is used
+    else if(r == LDB_ERR_NO_ID)
+	r = LDB_OK;
+    //buffer of env must fit page of table
+    db->h.flags = flags;
+    if(r == LDB_OK && env->buffer_size < min_buf_size(db))
+	r = LDB_ERR_SMALL_BUFFER;
+    if(r)
+    {
+	LDB_MUTEX_RELEASE(&env->mutex);   //reLease MUTEX
+	return r;
+    }
+    //new table is placed at the ends of files
+    for (uint8_t i = 0; i < 10; i++)
+	db->h.version[i] = ldb_ver[i];
+    db->h.header_size = header_size;
+    db->h.item_size = size;
+    db->h.count = 0;
+    db->h.flags = flags | LDB_F_SORTED; //empty table is sorted
+    memset(&t, 0, sizeof(t));
+    memcpy(t.name, name, strlen(name));
+    t.index_base = align_up(db, env->h.index_end);
+    t.data_base = align_up(db, env->h.data_end);
+    t.capacity = capacity;
+    env_table(env, db, &t);
+    //with LDB_F_CRC ID table has room for whole pages
+    ids = capacity;
+    if(flags & LDB_F_CRC)
+	ids = (capacity + LDB_CRC_PAGE_IDS - 1) /
+	    LDB_CRC_PAGE_IDS * LDB_CRC_PAGE_IDS;
+    if((r = update_sysheader(db)) == LDB_OK &&
+       header != 0 && header_size != 0 &&
+       (ldb_io_write(&env->file_index, header, header_size, &bw) ||
+	bw != header_size))
+	r = LDB_ERR_IO;
+    //add table to catalog
+    if(r == LDB_OK &&
+       (ldb_io_lseek(&env->file_index,
+		     sizeof(env->h) + env->h.tables * sizeof(t),
+		     SEEK_SET) ||
+	ldb_io_write(&env->file_index, (uint8_t*)&t, sizeof(t), &bw) ||
+	bw != sizeof(t)))
+	r = LDB_ERR_IO;
+    if(r == LDB_OK)
+    {
+	uint32_t index_end = env->h.index_end, data_end = env->h.data_end;
+	env->h.tables ++;
+	env->h.index_end = id_offset(db, ids);
+	env->h.data_end = t.data_base + capacity * item_stride(db);
+	if((r = env_update_header(env)))
+	{
+	    env->h.tables --;
+	    env->h.index_end = index_end;
+	    env->h.data_end = data_end;
+	}
+    }
+    if(r)
+    {
+	db->opened = 0;
+	env->tables_opened --;
+    }
+    if(LDB_MUTEX_RELEASE(&env->mutex))    //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    return r;
+}
+#endif
+#if LDB_SHARED
+//read state of DB from file again. Processes which used block removed before
+//could change file after ldb_open()
+static LDB_RES reload_state(LighDB *db)
+{
+    uint32_t br;
+    if(ldb_io_sync(db->pfile_index) || ldb_io_sync(db->pfile_data) ||
+       ldb_io_lseek(db->pfile_index, db->index_base, SEEK_SET) ||
+       ldb_io_read(db->pfile_index, (uint8_t*)&db->h,
+		   sysheader_size(db), &br) ||
+       br != sysheader_size(db))
+	return LDB_ERR_IO;
+#if LDB_ID_PACK
+    if(db->h.flags & LDB_F_PACKED_IDS)
+    {
+	uint32_t v[2];
+	if(ldb_io_lseek(db->pfile_index, db->index_offset, SEEK_SET) ||
+	   ldb_io_read(db->pfile_index, (uint8_t*)v, 8, &br) ||
+	   br != 8)
+	    return LDB_ERR_IO;
+	db->pack_dir = v[0];
+	db->pack_size = v[1];
+    }
+#endif
+    if(read_last_id(db))
+	return LDB_ERR_IO;
+    //data read now isn't kept
+    if(ldb_io_sync(db->pfile_index) || ldb_io_sync(db->pfile_data))
+	return LDB_ERR_IO;
+    return LDB_OK;
+}
+LDB_RES ldb_share(LighDB *db, LDB_SHARED_BLOCK *shared, uint8_t init)
+{
+    if(db == 0 || shared == 0)
+	return LDB_ERR_ZERO_POINTER;
+    if(shared->buffer_size < LDB_MIN_ID_BUFF)
+	return LDB_ERR_SMALL_BUFFER;
+    if(db_lock(db))                   //reQuest MUTEX
+	return LDB_ERR_MUTEX;
+    LDB_RES r = LDB_OK;
+    if(db->opened == 0)
+	r = LDB_ERR_NOT_OPENED;
+    else if(db->env != 0 || db->shared != 0)
+	r = LDB_ERR;
+    else if(shared->buffer_size < min_buf_size(db))
+	r = LDB_ERR_SMALL_BUFFER;
+    else if(init)
+    {
+	//first process puts state of DB to block
+	if((r = reload_state(db)) == LDB_OK)
+	{
+	    shared->count = db->h.count;
+	    shared->flags = db->h.flags;
+	    shared->item_size = db->h.item_size;
+	    shared->last_id = db->last_id;
+#if LDB_ID_PACK
+	    shared->pack_dir = db->pack_dir;
+	    shared->pack_size = db->pack_size;
+#endif
+	    shared->buffer_start = 0;
+	    shared->buffer_count = 0;
+	}
+    }
+    else if(LDB_MUTEX_REQUEST(&shared->mutex))
+	r = LDB_ERR_MUTEX;
+    else
+    {
+	//block left by processes of other DB or of DB which was created again
+	//doesn't match header, which is written on every change
+	if((r = reload_state(db)) == LDB_OK &&
+	   (shared->count != db->h.count ||
+	    shared->item_size != db->h.item_size ||
+	    ((shared->flags ^ db->h.flags) & ~LDB_F_SORTED)))
+	    r = LDB_ERR_HEADER;
+	if(LDB_MUTEX_RELEASE(&shared->mutex) && r == LDB_OK)
+	    r = LDB_ERR_MUTEX;
+    }
+    if(r)
+    {
+	db_unlock(db);                //reLease MUTEX
+	return r;
+    }
+    db->buffer_id = shared->buffer;
+    db->buffer_id_size = shared->buffer_size;
+    db->buffer_id_count = 0;
+    if(db_unlock(db))                 //reLease MUTEX
+	return LDB_ERR_MUTEX;
+    //from now mutex of block is used and state is taken from block
+    db->shared = shared;
+    db->pmutex = &shared->mutex;
+    return LDB_OK;
+}
+#endif
 #if LDB_MUTEX == 0
 LDB_RES ldb_return_ok(LDB_MUTEX_t *x) {
     //REMOVE F**** unused varible
@@ -5,11 +5,15 @@
 #ifndef LIGHDB_H
 #define LIGHDB_H
 
-#define LIGHDB_VERSION "001"
+#define LIGHDB_VERSION "002"
 
 #include <stdint.h>
 #include "lighdb_conf.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #ifndef LDB_FILE //FILE type
 #define LDB_FILE int
 #endif
@@ -44,6 +48,60 @@
 #define LDB_MIN_ID_BUFF 2
 #endif
 
+#ifndef LDB_CHANGELOG //will change log be used
+#define LDB_CHANGELOG 0
+#endif
+#if LDB_READ_ONLY     //change log requires writing
+#undef LDB_CHANGELOG
+#define LDB_CHANGELOG 0
+#endif
+
+#ifndef LDB_SUMMARY //will summary of ID table pages be used, see ldb_summary_open()
+#define LDB_SUMMARY 0
+#endif
+#if LDB_READ_ONLY     //summary is updated by ldb_add()
+#undef LDB_SUMMARY
+#define LDB_SUMMARY 0
+#endif
+#ifndef LDB_SUMMARY_BLOOM //size of bloom filter of page in bytes. Power of 2, not bigger than 8192.
+#define LDB_SUMMARY_BLOOM 512 //It is on stack while summary is rebuilt
+#endif
+
+#ifndef LDB_PAX //will column split format LDB_F_PAX be supported, see ldb_create_pax()
+#define LDB_PAX 0
+#endif
+#ifndef LDB_PAX_FIELDS //max count of fields with LDB_F_PAX
+#define LDB_PAX_FIELDS 8
+#endif
+#ifndef LDB_PAX_BLOCK //count of items in block for new DBs with LDB_F_PAX
+#define LDB_PAX_BLOCK 64
+#endif
+#ifndef LDB_PACK_DIR //count of block headers in directory for new DBs with LDB_F_PACKED_IDS
+#define LDB_PACK_DIR 16
+#endif
+
+#ifndef LDB_ID_PACK //will packed ID table format LDB_F_PACKED_IDS be supported
+#define LDB_ID_PACK 0
+#endif
+
+#ifndef LDB_CRC //will CRC32C checksums format be supported
+#define LDB_CRC 0
+#endif
+
+#ifndef LDB_IO_READAHEAD //will ldb_io_readahead() be used for sequential reads
+#define LDB_IO_READAHEAD 0
+#endif
+
+#ifndef LDB_SHARED //can DB be shared by processes, see ldb_share()
+#define LDB_SHARED 0
+#endif
+#if LDB_SHARED && !LDB_MUTEX
+#error "LDB_SHARED needs LDB_MUTEX and mutex which works between processes"
+#endif
+#ifndef LDB_SHM_TIMEOUT //ms to wait for process which creates block in ldb_shm_open()
+#define LDB_SHM_TIMEOUT 1000
+#endif
+
 typedef enum {
     LDB_OK = 0,          // 0 Everything ok
     LDB_ERR,             // 1 Undefined error
@@ -56,6 +114,10 @@ typedef enum {
     LDB_ERR_SMALL_BUFFER,// 8 Small buffer size in argument
     LDB_ERR_ZERO_POINTER,// 9 Zero pointer in arg
     LDB_ERR_MUTEX,       // 10 error in mutex
+    LDB_ERR_SNAPSHOT,    // 11 Snapshot storage was too small for updated items
+    LDB_ERR_CRC,         // 12 Wrong checksum of item or ID table page
+    LDB_ERR_FULL,        // 13 No room for new item or table in env
+    LDB_ERR_SIZE,        // 14 Sizes of arguments don't match
 } LDB_RES;
 
 
@@ -112,21 +174,114 @@ LDB_RES ldb_io_lseek(LDB_FILE *file, uint32_t offset, int whence);
  * @return result LDB_OK or LDB_ERR
  */
 LDB_RES ldb_io_close(LDB_FILE *file);
+#if LDB_IO_READAHEAD
+/**
+ * Hint that part of file will be read soon. It must not wait for the data, only
+ * start reading it in background, f.e. posix_fadvise(POSIX_FADV_WILLNEED).
+ * Library calls it for the next sheet of ID table or chunk of items before
+ * it scans the current one, so reading and scanning overlap
+ *
+ * @param file file object or descriptor
+ * @param offset offset in bytes
+ * @param len length in bytes. Can be after the end of file
+ * @return result LDB_OK or LDB_ERR. Errors are ignored
+ */
+LDB_RES ldb_io_readahead(LDB_FILE *file, uint32_t offset, uint32_t len);
+#endif
 
 
 //Database consists from two files: one with item's data one by one, other with header, some values and table of ID's for each data item
 /*
   Index file structure:
 
-  |LightDB version(10bytes)|header_size(4bytes)|item_size(4bytes)|count(4bytes)|header(header_size bytes)|table of id(count*4 bytes)|
+  |LightDB version(10bytes)|header_size(4bytes)|item_size(4bytes)|count(4bytes)|flags(4bytes)|header(header_size bytes)|table of id(count*4 bytes)|
   Data file structure:
   |LightDB version(10bytes)|item's data one by one(item_size * count bytes)|
+
+  Version 001 has no flags field. DB created without format flags is written in version 001,
+  so older library can open it, and its LDB_F_SORTED is not kept after close. DB created
+  with any flag, LDB_F_SORTED too, is written in version 002.
+  With LDB_F_CRC every item is followed by CRC32C of item (4bytes) and table of id is
+  split to pages of LDB_CRC_PAGE_IDS IDs, each page ends with CRC32C of its IDs (4bytes).
+  With LDB_F_ALIGNED table of id and item's data start at offsets aligned to LDB_ALIGN,
+  space before them is padding. With LDB_F_ALIGN_ROWS every item (with its CRC) is padded
+  to power of 2 size, or to whole pages if it is bigger than page, so item doesn't cross
+  page. It requires LDB_F_ALIGNED.
+  LDB_F_SORTED means that IDs are in ascending order, so table of id is searched
+  by binary search in file.
+  With LDB_F_PAX data file is:
+  |LightDB version(10bytes)|block_rows(4bytes)|fields(4bytes)|LDB_FIELD of every field|blocks|
+  Items are stored in blocks of block_rows items. Inside block values of every field
+  are one by one: |field 0 of block_rows items|field 1 of block_rows items|...|
+  Fields follow each other and cover whole item. It can't be used with LDB_F_CRC
+  and LDB_F_ALIGN_ROWS.
+  With LDB_F_PACKED_IDS table of id is:
+  |count of headers in directory(4bytes)|size of packed values(4bytes)|directory|packed values|
+  last IDs(count % LDB_PACK_IDS * 4bytes)|
+  Every LDB_PACK_IDS IDs are packed to block, its header in directory is:
+  |min ID(4bytes)|max ID(4bytes)|offset of values(4bytes)|bits(1byte)|delta(1byte)|
+  and its values are LDB_PACK_IDS * bits / 8 bytes from offset in packed values.
+  Value is ID - min, or ID - previous ID if delta is 1. Last IDs after blocks aren't packed.
+  Directory has room for LDB_PACK_DIR headers and is doubled when full, then
+  packed values and last IDs are moved. It can't be used with LDB_F_CRC.
+
+  Env stores many tables in one pair of files:
+  Env index file structure:
+  |LighEnv version(10bytes)|tables_max(4bytes)|tables(4bytes)|index_end(4bytes)|data_end(4bytes)|catalog(tables_max*LDB_ENV_TABLE)|tables|
+  Every table in env index file is like index file of DB, but its table of id has room for capacity IDs.
+  Env data file structure:
+  |LighEnv version(10bytes)|items of tables, capacity*item_size bytes for each table|
 */
+
+//Format flags
+#define LDB_F_CRC 0x01 //items and pages of ID table have CRC32C
+#define LDB_F_ALIGNED 0x02 //table of id and data start at page boundary
+#define LDB_F_ALIGN_ROWS 0x04 //items don't cross page boundaries
+#define LDB_F_SORTED 0x08 //IDs are in ascending order, set at create and cleared by ldb_add(). Pass it to ldb_create_ex() to keep it after close
+#define LDB_F_PAX 0x10 //items are split to fields, see ldb_create_pax()
+#define LDB_F_PACKED_IDS 0x20 //table of id is packed to blocks with bit packing
+
+#define LDB_ALIGN 4096 //size of page for LDB_F_ALIGNED
+
+#define LDB_CRC_PAGE_IDS 127 //count of IDs in page of ID table with LDB_F_CRC
+#define LDB_SUMMARY_IDS (8 * LDB_CRC_PAGE_IDS) //count of IDs in page of summary
+#define LDB_PACK_IDS 128 //count of IDs in block with LDB_F_PACKED_IDS. Buffer must fit it
+
 /*
   INDEX is unique and it defines index in data array
   ID can be not unique and just defines link between INDEX and some number
  */
 
+struct LDB_SNAPSHOT;
+struct LighDBEnv;
+
+//Field of item for LDB_F_PAX
+typedef struct __attribute__((packed)) {
+    uint32_t offset; //offset of field in item
+    uint32_t len;    //size of field
+} LDB_FIELD;
+
+#if LDB_SHARED
+//State of DB in memory shared by processes. Buffer for ID table is shared too
+typedef struct {
+    LDB_MUTEX_t mutex;     //mutex which works between processes
+    uint32_t ready;        //for ldb_shm_open(): 0 - block is being created, 1 - ready, 2 - removed
+    uint32_t users;        //for ldb_shm_open(): count of processes which use block
+    uint32_t count;        //count of items
+    uint32_t flags;        //format flags
+    uint32_t item_size;    //size of item
+    uint32_t last_id;      //ID of last item
+    uint32_t buffer_start; //first index of IDs in buffer
+    uint32_t buffer_count; //count of IDs in buffer
+    uint32_t buffer_size;  //size of buffer in IDs
+#if LDB_ID_PACK
+    uint32_t pack_dir;     //count of headers in directory of ID table
+    uint32_t pack_size;    //size of packed values of ID table
+#endif
+    uint32_t buffer[];     //shared buffer, like buffer of ldb_set_buffer()
+} LDB_SHARED_BLOCK;
+#endif
+
 typedef struct {
     uint8_t opened;
     
@@ -138,16 +293,54 @@ typedef struct {
 	uint32_t header_size  :32; //size of header
 	uint32_t item_size    :32; //size of single item
 	uint32_t count        :32; //total count of items
+	uint32_t flags        :32; //format flags LDB_F_
     } h;
     
     uint32_t index_offset; //offset of ID data in file_index
     uint32_t data_offset; //offset of data in file_data
     //buffers
     uint32_t *buffer_id;
-    uint32_t buffer_id_size;
+    uint32_t buffer_id_size;        //size of buffer in IDs
     uint32_t buffer_id_start_index;
     uint32_t buffer_id_count;
     
+    struct LDB_SNAPSHOT *snapshots; //list of active snapshots
+
+    //files and mutex used. They are DB's own or env's, if DB is table of env
+    LDB_FILE *pfile_data;
+    LDB_FILE *pfile_index;
+    LDB_MUTEX_t *pmutex;
+    struct LighDBEnv *env; //env of table or 0
+    uint32_t index_base;   //offset of DB's system header in file_index
+    uint32_t capacity;     //max count of items in table of env. 0 - unlimited
+    uint32_t last_id;      //ID of last item, for LDB_F_SORTED
+#if LDB_ID_PACK
+    uint32_t pack_dir;     //count of headers in directory with LDB_F_PACKED_IDS
+    uint32_t pack_size;    //size of packed values
+#endif
+#if LDB_PAX
+    uint32_t pax_block;    //count of items in block with LDB_F_PAX
+    uint32_t pax_fields;   //count of fields
+    LDB_FIELD pax[LDB_PAX_FIELDS];
+#endif
+#if LDB_SHARED
+    LDB_SHARED_BLOCK *shared; //state shared by processes or 0
+#endif
+
+#if LDB_CHANGELOG
+    LDB_FILE file_log;     //change log
+    uint8_t log_opened;
+    uint32_t log_seq;      //sequence number of last change
+    uint32_t log_size;     //size of change log file
+    uint32_t log_hint_seq; //last change read by ldb_changes_since
+    uint32_t log_hint_pos; //position of record after it
+#endif
+#if LDB_SUMMARY
+    LDB_FILE file_sum;     //summary of ID table pages
+    uint8_t sum_opened;
+    uint32_t sum_count;    //count of items in summary
+#endif
+
     LDB_MUTEX_t mutex; //mutex if enabled
 } LighDB;
 
@@ -175,13 +368,17 @@ LDB_RES ldb_close(LighDB *db);
  *
  * @param db pointer to DB structure 
  * @param buffer buffer
- * @param size size of buffer in bytes
+ * @param size size of buffer in bytes. Buffer is used for ID table and by ldb_scan() for items.
+ * With LDB_F_CRC it must fit page of (LDB_CRC_PAGE_IDS + 1) * 4 bytes,
+ * with LDB_F_PACKED_IDS block of LDB_PACK_IDS * 4 bytes
  * @retur result LDB_OK, LDB_ERR_SMALL_BUFFER
  */
 LDB_RES ldb_set_buffer(LighDB *db, uint32_t *buffer, uint32_t size);
 #if !LDB_READ_ONLY
 /**
  * Create new database. AFTER CREATE call ldb_set_buffer()
+ * DB is written in version 001, so LDB_F_SORTED isn't kept after close.
+ * Use ldb_create_ex() with LDB_F_SORTED to keep binary search after reopen
  *
  * @param db pointer to DB structure
  * @param path_data path to data DB file
@@ -194,6 +391,44 @@ LDB_RES ldb_set_buffer(LighDB *db, uint32_t *buffer, uint32_t size);
 LDB_RES ldb_create(LighDB *db, char *path_index, char *path_data,
 		   uint32_t size,
 		   uint32_t header_size, uint8_t *header);
+/**
+ * Create new database with format flags. AFTER CREATE call ldb_set_buffer()
+ *
+ * @param db pointer to DB structure
+ * @param path_data path to data DB file
+ * @param path_index path to index DB file
+ * @param size size of a single item's data
+ * @param header_size size of header
+ * @param header header buffer
+ * @param flags format flags LDB_F_
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_HEADER if flag isn't supported
+ */
+LDB_RES ldb_create_ex(LighDB *db, char *path_index, char *path_data,
+		      uint32_t size,
+		      uint32_t header_size, uint8_t *header,
+		      uint32_t flags);
+#if LDB_PAX
+/**
+ * Create new database with LDB_F_PAX: values of every field are stored together
+ * in blocks, so ldb_aggregate() and ldb_scan() with LDB_PRED on field read only this field.
+ * Items are read and written whole as usual. AFTER CREATE call ldb_set_buffer()
+ *
+ * @param db pointer to DB structure
+ * @param path_data path to data DB file
+ * @param path_index path to index DB file
+ * @param size size of a single item's data
+ * @param header_size size of header
+ * @param header header buffer
+ * @param flags format flags LDB_F_, except LDB_F_CRC and LDB_F_ALIGN_ROWS
+ * @param fields fields of item. Each starts where previous ends and last ends at size
+ * @param count count of fields, not bigger than LDB_PAX_FIELDS
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR if fields are wrong, LDB_ERR_HEADER if flag isn't supported
+ */
+LDB_RES ldb_create_pax(LighDB *db, char *path_index, char *path_data,
+		       uint32_t size,
+		       uint32_t header_size, uint8_t *header,
+		       uint32_t flags, LDB_FIELD *fields, uint32_t count);
+#endif
 #endif
 /**
  * Get data from first found item by ID
@@ -230,6 +465,18 @@ LDB_RES ldb_upd(LighDB *db, uint32_t id,
  */
 LDB_RES ldb_get_ind(LighDB *db, uint32_t index,
 		    uint8_t *buf, uint32_t size);
+/**
+ * Get data of count items one by one starting from index
+ *
+ * @param db pointer to DB structure
+ * @param index index of first item
+ * @param count count of items
+ * @param buf buffer of data
+ * @param size size of buffer. Must be at least count * item size
+ * @return result LDB_OK, LDB_ERR_IO, LDB_BIG_INDEX, LDB_ERR_SMALL_BUFFER
+ */
+LDB_RES ldb_get_range(LighDB *db, uint32_t index, uint32_t count,
+		      uint8_t *buf, uint32_t size);
 #if !LDB_READ_ONLY
 /**
  * Change item's data by index
@@ -242,6 +489,38 @@ LDB_RES ldb_get_ind(LighDB *db, uint32_t index,
  */
 LDB_RES ldb_upd_ind(LighDB *db, uint32_t index,
 		    void *data, uint32_t size);
+/**
+ * Change data of many items by indexes. Mutex is taken once, items are written in order
+ * of indexes and neighbour items are written at once. Buffer set by ldb_set_buffer() is used
+ * to sort them, so they are updated in batches which fit in buffer, 4 + item size bytes for each item.
+ * If index is repeated, then its last data is written
+ *
+ * @param db pointer to DB structure
+ * @param indexes indexes of items
+ * @param items data of items one by one
+ * @param count count of items
+ * @param size size of items in bytes
+ * @return result LDB_OK, LDB_ERR_IO, LDB_BIG_INDEX if some index is too big, then nothing is changed, LDB_ERR_SMALL_BUFFER
+ */
+LDB_RES ldb_upd_many_ind(LighDB *db, uint32_t *indexes,
+			 void *items, uint32_t count, uint32_t size);
+/**
+ * Change data of first found items by IDs, like ldb_upd() for every ID. IDs of batch are found
+ * in one pass through ID table, then items are written like by ldb_upd_many_ind().
+ * Batch needs 8 + item size bytes of buffer for each item, besides one page of ID table
+ * (LDB_MIN_ID_BUFF IDs, LDB_CRC_PAGE_IDS + 1 with LDB_F_CRC or LDB_PACK_IDS with
+ * LDB_F_PACKED_IDS), which is kept for search
+ *
+ * @param db pointer to DB structure
+ * @param ids IDs of items
+ * @param items data of items one by one
+ * @param count count of items
+ * @param size size of items in bytes
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_SMALL_BUFFER, LDB_ERR_NO_ID if some ID isn't found,
+ * then items of its batch aren't changed, but items of previous batches are
+ */
+LDB_RES ldb_upd_many(LighDB *db, uint32_t *ids,
+		     void *items, uint32_t count, uint32_t size);
 /**
  * Add new item
  *
@@ -250,12 +529,46 @@ LDB_RES ldb_upd_ind(LighDB *db, uint32_t index,
  * @param size size of data
  * @param id ID of new item
  * @param newindex returns index of new item
- * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_SMALL_BUFFER
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_SMALL_BUFFER, LDB_ERR_FULL if table of env is full
  */
 LDB_RES ldb_add(LighDB *db,
 		void *data, uint32_t size,
 		uint32_t id, uint32_t *newindex);
 #endif
+#if !LDB_READ_ONLY
+/**
+ * Reader of items for ldb_bulk_load
+ *
+ * @param item buffer to put item's data to. Its size is size of item
+ * @param id returns ID of item
+ * @param arg argument from ldb_bulk_load
+ * @return 1 if item was read, 0 if there are no more items, 2 if item can't be read
+ */
+typedef uint8_t (*ldb_bulk_reader)(uint8_t *item, uint32_t *id, void *arg);
+/**
+ * Create new database and fill it with items from reader. Items and IDs are collected
+ * in buffer and written with big sequential writes, DB header is written once at the end.
+ * After load DB is opened and buffer is set, like after ldb_create() and ldb_set_buffer().
+ * If load fails after DB is created, then DB is closed and its files keep empty DB
+ *
+ * @param db pointer to DB structure
+ * @param path_index path to index DB file
+ * @param path_data path to data DB file
+ * @param size size of a single item's data
+ * @param header_size size of header
+ * @param header header buffer
+ * @param buffer buffer. Bigger buffer - less writes. It must fit at least one item and its ID
+ * @param buffer_size size of buffer in bytes
+ * @param reader function which returns items one by one
+ * @param arg argument for reader
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_SMALL_BUFFER, LDB_ERR if reader failed
+ */
+LDB_RES ldb_bulk_load(LighDB *db, char *path_index, char *path_data,
+		      uint32_t size,
+		      uint32_t header_size, uint8_t *header,
+		      uint32_t *buffer, uint32_t buffer_size,
+		      ldb_bulk_reader reader, void *arg);
+#endif
 /**
  * Get count of indexes of items with selected ID. And if list != 0 && len != 0 then put found indexes in the list
  *
@@ -268,6 +581,34 @@ LDB_RES ldb_add(LighDB *db,
 LDB_RES ldb_find_by_id(LighDB *db, uint32_t id,
 		       uint32_t *count,
 		       uint32_t *list, uint32_t len);
+//Cursor of search by ID, see ldb_find_begin()
+typedef struct {
+    LighDB *db;
+    uint32_t id;   //searched ID
+    uint32_t next; //index from which search continues
+} LDB_FIND;
+/**
+ * Begin paginated search of items with ID. Doesn't read anything
+ *
+ * @param db pointer to DB structure
+ * @param f cursor
+ * @param id ID to search
+ * @return result LDB_OK
+ */
+LDB_RES ldb_find_begin(LighDB *db, LDB_FIND *f, uint32_t id);
+/**
+ * Get next page of indexes of items with ID. Search continues from place where
+ * previous page ended, so all pages are found in one pass through ID table.
+ * Items added after the end of previous page are found too
+ *
+ * @param f cursor from ldb_find_begin()
+ * @param count returns count of found indexes. If it is < len then search is over
+ * @param list array for found indexes
+ * @param len length of array
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_SMALL_BUFFER if len is 0
+ */
+LDB_RES ldb_find_next(LDB_FIND *f, uint32_t *count,
+		      uint32_t *list, uint32_t len);
 LDB_RES ldb_get_header(LighDB *db,
 		       uint8_t *buf, uint32_t size,
 		       uint32_t *read);
@@ -276,10 +617,465 @@ LDB_RES ldb_set_header(LighDB *db,
 		       uint8_t *buf, uint32_t size,
 		       uint32_t *written);
 #endif
+
+//Types of item's fields for built-in predicates
+typedef enum {
+    LDB_T_BYTES = 0, // raw bytes, compared like memcmp
+    LDB_T_U8,
+    LDB_T_U16,
+    LDB_T_U32,
+    LDB_T_U64,
+    LDB_T_I8,
+    LDB_T_I16,
+    LDB_T_I32,
+    LDB_T_I64,
+    LDB_T_F32,
+    LDB_T_F64,
+} LDB_TYPE;
+
+//Compare operations for built-in predicates. field OP value
+typedef enum {
+    LDB_EQ = 0,
+    LDB_NE,
+    LDB_LT,
+    LDB_LE,
+    LDB_GT,
+    LDB_GE,
+} LDB_OP;
+
+/**
+ * Caller predicate
+ *
+ * @param item item's data
+ * @param size size of item
+ * @param arg argument from LDB_PRED
+ * @return 1 if item matches, 0 if not
+ */
+typedef uint8_t (*ldb_match_fn)(uint8_t *item, uint32_t size, void *arg);
+/**
+ * Scan callback. Called with mutex taken, so don't call ldb_ functions for the same db inside
+ *
+ * @param index index of matched item
+ * @param item item's data. Valid only during the call
+ * @param size size of item
+ * @param arg argument from ldb_scan
+ * @return 0 to continue scan, other to stop it
+ */
+typedef uint8_t (*ldb_scan_fn)(uint32_t index, uint8_t *item, uint32_t size, void *arg);
+
+//Predicate for ldb_scan. Either caller function or built-in compare of a field
+typedef struct {
+    ldb_match_fn fn;  //caller predicate. If != 0 then fields below are ignored
+    void *arg;        //argument for fn
+
+    uint32_t offset;  //offset of field in item
+    uint32_t len;     //length of field. Used only for LDB_T_BYTES
+    LDB_TYPE type;    //type of field
+    LDB_OP op;        //compare operation
+    void *value;      //value to compare with. Same type as field
+} LDB_PRED;
+
+/**
+ * Scan all items of DB and call callback for every item matched by predicate.
+ * Data file is read sequentially in chunks of buffer size, set by ldb_set_buffer().
+ * Mutex is taken for each chunk separately.
+ *
+ * @param db pointer to DB structure
+ * @param pred predicate. If 0 then every item matches
+ * @param callback function called for each matched item
+ * @param arg argument for callback
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_SMALL_BUFFER if buffer is smaller than one item
+ */
+LDB_RES ldb_scan(LighDB *db, LDB_PRED *pred,
+		 ldb_scan_fn callback, void *arg);
+
+//Aggregate operations for ldb_aggregate
+typedef enum {
+    LDB_AGG_COUNT = 0,
+    LDB_AGG_SUM,
+    LDB_AGG_MIN,
+    LDB_AGG_MAX,
+} LDB_AGG;
+
+//Result of aggregation
+typedef struct {
+    uint32_t count;  //count of aggregated items
+    union {
+	int64_t  i;  //for signed types
+	uint64_t u;  //for unsigned types
+	double   f;  //for float types
+    } v;             //value of SUM, MIN or MAX. Not valid if count == 0
+} LDB_AGG_RES;
+
+/**
+ * Aggregate numeric field of items in range [from; to).
+ * Data file is read sequentially in chunks of buffer size, set by ldb_set_buffer().
+ * Range can be split between several calls and results combined by ldb_aggregate_merge()
+ *
+ * @param db pointer to DB structure
+ * @param offset offset of field in item
+ * @param type type of field. LDB_T_BYTES isn't supported
+ * @param op aggregate operation
+ * @param from index of first item
+ * @param to index after last item. If bigger than count of items then it is equal to count
+ * @param out result
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR if field is not inside item, LDB_ERR_SMALL_BUFFER
+ */
+LDB_RES ldb_aggregate(LighDB *db, uint32_t offset,
+		      LDB_TYPE type, LDB_AGG op,
+		      uint32_t from, uint32_t to,
+		      LDB_AGG_RES *out);
+/**
+ * Combine result of aggregation of other range into out
+ *
+ * @param type type of field
+ * @param op aggregate operation
+ * @param out result to combine into
+ * @param part result of other range
+ */
+void ldb_aggregate_merge(LDB_TYPE type, LDB_AGG op,
+			 LDB_AGG_RES *out, LDB_AGG_RES *part);
+
+//Consistent view of DB. Items added after begin aren't visible,
+//old versions of items updated after begin are saved in undo storage
+typedef struct LDB_SNAPSHOT {
+    LighDB *db;
+    uint32_t count;      //count of items in view
+
+    uint8_t *undo;       //storage for old versions: |index(4 bytes)|item's data| one by one
+    uint32_t undo_size;  //size of storage in bytes
+    uint32_t undo_count; //count of saved items
+    uint8_t overflow;    //1 if storage was too small, so snapshot isn't valid anymore
+
+    struct LDB_SNAPSHOT *next;
+} LDB_SNAPSHOT;
+
+/**
+ * Begin snapshot. Until ldb_snapshot_end() every update of item in view
+ * saves old version of item in undo storage, so it needs (4 + item size) bytes for each updated item.
+ * Reading from snapshot takes mutex only for each read or chunk, so writers aren't blocked by long scans
+ *
+ * @param db pointer to DB structure
+ * @param snap snapshot object
+ * @param undo undo storage. Can be 0 if no updates are expected
+ * @param undo_size size of undo storage in bytes
+ * @return result LDB_OK, LDB_ERR_MUTEX
+ */
+LDB_RES ldb_snapshot_begin(LighDB *db, LDB_SNAPSHOT *snap,
+			   uint8_t *undo, uint32_t undo_size);
+/**
+ * End snapshot. After that undo storage isn't used
+ *
+ * @param snap snapshot object
+ * @return result LDB_OK, LDB_ERR_MUTEX
+ */
+LDB_RES ldb_snapshot_end(LDB_SNAPSHOT *snap);
+/**
+ * Get data of item by index as it was at snapshot begin
+ *
+ * @param snap snapshot object
+ * @param index index of item
+ * @param buf buffer of data
+ * @param size size of data
+ * @return result LDB_OK, LDB_ERR_IO, LDB_BIG_INDEX, LDB_ERR_SMALL_BUFFER, LDB_ERR_SNAPSHOT
+ */
+LDB_RES ldb_snapshot_get_ind(LDB_SNAPSHOT *snap, uint32_t index,
+			     uint8_t *buf, uint32_t size);
+/**
+ * Same as ldb_scan() but for snapshot
+ *
+ * @return result same as ldb_scan() and LDB_ERR_SNAPSHOT
+ */
+LDB_RES ldb_snapshot_scan(LDB_SNAPSHOT *snap, LDB_PRED *pred,
+			  ldb_scan_fn callback, void *arg);
+/**
+ * Same as ldb_aggregate() but for snapshot
+ *
+ * @return result same as ldb_aggregate() and LDB_ERR_SNAPSHOT
+ */
+LDB_RES ldb_snapshot_aggregate(LDB_SNAPSHOT *snap, uint32_t offset,
+			       LDB_TYPE type, LDB_AGG op,
+			       uint32_t from, uint32_t to,
+			       LDB_AGG_RES *out);
+#if LDB_CHANGELOG
+//Change log file structure:
+//|LightDB version(10bytes)|change record|data of change(size bytes)|...|
+
+//Operations in change log
+typedef enum {
+    LDB_CHANGE_ADD = 1,   //ldb_add. Data is item
+    LDB_CHANGE_UPD,       //ldb_upd_ind, ldb_upd or ldb_upd_many. Data is item
+    LDB_CHANGE_HEADER,    //ldb_set_header. Data is header
+} LDB_CHANGE_OP;
+
+//Change record
+typedef struct __attribute__((packed)) {
+    uint32_t seq   :32; //sequence number. First change has 1
+    uint8_t  op    :8;  //LDB_CHANGE_OP
+    uint32_t index :32; //index of added or updated item
+    uint32_t id    :32; //ID of added item
+    uint32_t size  :32; //size of data after record
+} LDB_CHANGE;
+
+/**
+ * Change log callback. Called with mutex taken, so don't call ldb_ functions for the same db inside
+ *
+ * @param ch change record
+ * @param data data of change. Valid only during the call
+ * @param arg argument from ldb_changes_since
+ * @return 0 to continue, other to stop
+ */
+typedef uint8_t (*ldb_change_fn)(LDB_CHANGE *ch, uint8_t *data, void *arg);
+
+/**
+ * Open change log of opened DB. After that every ldb_add, update of item and ldb_set_header
+ * appends record to the log
+ *
+ * @param db pointer to DB structure
+ * @param path path to change log file
+ * @param create if == 1 then create new log or clear existing. If == 0 then continue existing log
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_HEADER
+ */
+LDB_RES ldb_changelog_open(LighDB *db, char *path, uint8_t create);
+/**
+ * Close change log. It is closed by ldb_close() too
+ *
+ * @param db pointer to DB structure
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_NOT_OPENED
+ */
+LDB_RES ldb_changelog_close(LighDB *db);
+/**
+ * Call callback for every change with sequence number bigger than seq.
+ * Data of change is read to buffer, set by ldb_set_buffer()
+ *
+ * @param db pointer to DB structure
+ * @param seq sequence number of last known change. 0 for all changes
+ * @param callback function called for each change
+ * @param arg argument for callback
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_NOT_OPENED, LDB_ERR_SMALL_BUFFER
+ */
+LDB_RES ldb_changes_since(LighDB *db, uint32_t seq,
+			  ldb_change_fn callback, void *arg);
+/**
+ * Apply one change to DB
+ *
+ * @param db pointer to follower DB structure
+ * @param ch change record
+ * @param data data of change
+ * @return result LDB_OK, LDB_ERR if added item's index doesn't match, LDB_ERR_IO
+ */
+LDB_RES ldb_apply_change(LighDB *db, LDB_CHANGE *ch, uint8_t *data);
+/**
+ * Apply all changes of leader DB made after seq to follower DB.
+ * Leader and follower must not share mutex, so they can't be tables of one LighDBEnv
+ *
+ * @param leader pointer to DB structure with opened change log
+ * @param follower pointer to follower DB structure
+ * @param seq sequence number of last change applied to follower. 0 if follower is empty copy
+ * @param last returns sequence number of last applied change. Can be 0
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR if follower doesn't match leader or they share mutex
+ */
+LDB_RES ldb_apply_changes(LighDB *leader, LighDB *follower,
+			  uint32_t seq, uint32_t *last);
+#endif
+#if LDB_CRC
+/**
+ * Check checksums of all items and ID table pages. Files are read sequentially
+ * in chunks of buffer size, set by ldb_set_buffer()
+ *
+ * @param db pointer to DB structure
+ * @param bad returns index of first damaged item, or first index of damaged ID table page. Can be 0
+ * @return result LDB_OK, LDB_ERR_CRC, LDB_ERR_IO, LDB_ERR if DB has no checksums
+ */
+LDB_RES ldb_verify(LighDB *db, uint32_t *bad);
+#endif
+#if LDB_SUMMARY
+//Summary file structure:
+//|LighSum version(10bytes)|ids_per_page(4bytes)|bloom_size(4bytes)|count(4bytes)|page summary|...|
+//Page summary for every LDB_SUMMARY_IDS IDs of ID table:
+//|min ID(4bytes)|max ID(4bytes)|bloom filter of IDs(LDB_SUMMARY_BLOOM bytes)|
+//
+//ldb_find_by_id() and ldb_find_next() of table without LDB_F_SORTED don't read
+//pages of ID table, which can't contain ID by their summary.
+
+/**
+ * Open summary of opened DB. After that ldb_add() updates it.
+ * If summary doesn't match DB, then it is rebuilt from ID table with buffer set by ldb_set_buffer().
+ * Summary isn't shared in LDB_SHARED mode: items added by other processes
+ * aren't in summary, so their pages are always read
+ *
+ * @param db pointer to DB structure
+ * @param path path to summary file
+ * @param create if == 1 then create new file or clear existing. If == 0 then use existing
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_NO_BUFFER, LDB_ERR_CRC
+ */
+LDB_RES ldb_summary_open(LighDB *db, char *path, uint8_t create);
+/**
+ * Close summary. It is closed by ldb_close() too
+ *
+ * @param db pointer to DB structure
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_NOT_OPENED
+ */
+LDB_RES ldb_summary_close(LighDB *db);
 #endif
 
+#define LDB_ENV_NAME_SIZE 20 //size of table name in catalog, including ending zero
 
+//Entry of env catalog
+typedef struct __attribute__((packed)) {
+    char name[LDB_ENV_NAME_SIZE]; //name of table, zero padded
+    uint32_t index_base;          //offset of table in env index file
+    uint32_t data_base;           //offset of table's items in env data file
+    uint32_t capacity;            //max count of items
+} LDB_ENV_TABLE;
 
+//Many tables in one pair of files. Tables share files, mutex and buffer of env
+typedef struct LighDBEnv {
+    uint8_t opened;
+
+    LDB_FILE file_data;   //file with items of all tables
+    LDB_FILE file_index;  //file with catalog and ID tables of all tables
+
+    struct __attribute__((packed)) {
+	char version[10];
+	uint32_t tables_max :32; //size of catalog
+	uint32_t tables     :32; //count of tables
+	uint32_t index_end  :32; //end of last table in index file
+	uint32_t data_end   :32; //end of last table in data file
+    } h;
 
+    uint32_t *buffer;
+    uint32_t buffer_size;  //size of buffer in IDs
+    LighDB *buffer_owner;  //table whose IDs are in buffer
+    uint32_t tables_opened;
 
+    LDB_MUTEX_t mutex; //mutex if enabled
+} LighDBEnv;
 
+/**
+ * Open existing env. AFTER open call ldb_env_set_buffer()
+ *
+ * @param env pointer to env structure
+ * @param path_index path to index file of env
+ * @param path_data path to data file of env
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_HEADER
+ */
+LDB_RES ldb_env_open(LighDBEnv *env, char *path_index, char *path_data);
+#if !LDB_READ_ONLY
+/**
+ * Create new empty env. AFTER create call ldb_env_set_buffer()
+ *
+ * @param env pointer to env structure
+ * @param path_index path to index file of env
+ * @param path_data path to data file of env
+ * @param tables_max max count of tables
+ * @return result LDB_OK, LDB_ERR_IO
+ */
+LDB_RES ldb_env_create(LighDBEnv *env, char *path_index, char *path_data,
+		       uint32_t tables_max);
+#endif
+/**
+ * Set buffer of env. It is shared by all tables and used like buffer of ldb_set_buffer().
+ * Set it before tables are opened
+ *
+ * @param env pointer to env structure
+ * @param buffer buffer
+ * @param size size of buffer in bytes
+ * @return result LDB_OK, LDB_ERR_SMALL_BUFFER
+ */
+LDB_RES ldb_env_set_buffer(LighDBEnv *env, uint32_t *buffer, uint32_t size);
+/**
+ * Close env. All its tables must be closed by ldb_close() before
+ *
+ * @param env pointer to env structure
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR if some tables are opened
+ */
+LDB_RES ldb_env_close(LighDBEnv *env);
+/**
+ * Open table of env by name. Table is used with ldb_ functions like DB and closed by ldb_close().
+ * Don't open the same table twice at the same time
+ *
+ * @param env pointer to env structure
+ * @param db pointer to DB structure of table
+ * @param name name of table
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_NO_ID if there is no such table, LDB_ERR_NO_BUFFER,
+ * LDB_ERR_SMALL_BUFFER if buffer of env doesn't fit page of table
+ */
+LDB_RES ldb_env_open_table(LighDBEnv *env, LighDB *db, char *name);
+#if !LDB_READ_ONLY
+/**
+ * Create new table in env and open it. Like ldb_create_ex(), but count of items is limited
+ *
+ * @param env pointer to env structure
+ * @param db pointer to DB structure of table
+ * @param name name of table. Shorter than LDB_ENV_NAME_SIZE
+ * @param size size of a single item's data
+ * @param header_size size of header
+ * @param header header buffer
+ * @param flags format flags LDB_F_, except LDB_F_PAX and LDB_F_PACKED_IDS
+ * @param capacity max count of items. ldb_add() returns LDB_ERR_FULL after it
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_FULL if catalog is full, LDB_ERR if name is used or wrong,
+ * LDB_ERR_SMALL_BUFFER if buffer of env doesn't fit page of table
+ */
+LDB_RES ldb_env_create_table(LighDBEnv *env, LighDB *db, char *name,
+			     uint32_t size,
+			     uint32_t header_size, uint8_t *header,
+			     uint32_t flags, uint32_t capacity);
+#endif
+#if LDB_SHARED
+/**
+ * Flush data written to file and drop cached read data.
+ * Called before mutex is released by DB shared by processes
+ *
+ * @param file file object or descriptor
+ * @return result LDB_OK or LDB_ERR
+ */
+LDB_RES ldb_io_sync(LDB_FILE *file);
+/**
+ * Share opened DB with other processes through block in shared memory.
+ * After that count of items, format flags, mutex and buffer are taken from block,
+ * so appends of one process are seen by others at once and buffer with ID table is common.
+ * Block's mutex must work between processes. Don't call ldb_set_buffer() after it.
+ * Snapshots and change log are not shared. Tables of env can't be shared.
+ * See ldb_shm_open() of lighdb_shm.c
+ *
+ * @param db pointer to DB structure, opened by ldb_open()
+ * @param shared shared block with initialized mutex and buffer_size
+ * @param init 1 if it is first process, it puts state of DB to block.
+ * Otherwise state in block is checked against header of DB file
+ * @return result LDB_OK, LDB_ERR_SMALL_BUFFER, LDB_ERR if DB is table of env or is shared already,
+ * LDB_ERR_HEADER if block doesn't match DB file, f.e. DB was created again while block was used, LDB_ERR_IO
+ */
+LDB_RES ldb_share(LighDB *db, LDB_SHARED_BLOCK *shared, uint8_t init);
+/**
+ * Open or create POSIX shared memory block for DB and share DB with ldb_share().
+ * Process waits for process which creates block not longer than LDB_SHM_TIMEOUT ms
+ *
+ * @param db pointer to DB structure, opened by ldb_open()
+ * @param name name of shared memory object, f.e. "/mydb"
+ * @param buffer_size size of shared buffer in bytes, used by process which creates block
+ * @return result LDB_OK, LDB_ERR, LDB_ERR_HEADER if block is used with other DB, see ldb_share()
+ */
+LDB_RES ldb_shm_open(LighDB *db, char *name, uint32_t buffer_size);
+/**
+ * Close DB shared by ldb_shm_open() and unmap shared memory.
+ * Last process which uses block removes it
+ *
+ * @param db pointer to DB structure
+ * @param name name of shared memory object
+ * @return result LDB_OK, LDB_ERR_IO, LDB_ERR_MUTEX
+ */
+LDB_RES ldb_shm_close(LighDB *db, char *name);
+/**
+ * Remove shared memory block left by crashed processes. Processes which use it
+ * keep it, new ones create new block
+ *
+ * @param name name of shared memory object
+ * @return result LDB_OK, LDB_ERR if there is no such block
+ */
+LDB_RES ldb_shm_unlink(char *name);
+#endif
+#ifdef __cplusplus
+}
+#endif
+#endif
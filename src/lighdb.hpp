@@ -0,0 +1,249 @@
+/*
+  Author: Alexander Lutsai <s.lyra@ya.ru>
+  LICENSE: BSD 2-Clause License
+*/
+#ifndef LIGHDB_HPP
+#define LIGHDB_HPP
+
+//Header-only C++20 wrapper: typed table of trivially copyable items T.
+//Item size is checked once at open, then all copies are sizeof(T).
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "lighdb.h"
+
+namespace lighdb {
+
+template <typename T, std::size_t BufferSize = 512>
+class Table {
+    static_assert(std::is_trivially_copyable_v<T>,
+		  "items are copied to and from files byte by byte");
+    //T isn't constructed by Table, items are read to storage of bytes
+    using Storage = std::byte[sizeof(T)];
+    static_assert(BufferSize >= LDB_MIN_ID_BUFF * sizeof(uint32_t),
+		  "buffer is too small for ID table");
+
+    //DB and its buffer are kept on heap, so moving Table doesn't move them
+    struct State {
+	LighDB db;
+	uint32_t buffer[BufferSize / sizeof(uint32_t)];
+    };
+    std::unique_ptr<State> s;
+
+    void init() { s = std::make_unique<State>(); }
+    LDB_RES set_buffer()
+    {
+	LDB_RES r = ldb_set_buffer(&s->db, s->buffer, sizeof(s->buffer));
+	if(r != LDB_OK)
+	    close();
+	return r;
+    }
+
+public:
+    Table() = default;
+    Table(const Table&) = delete;
+    Table &operator=(const Table&) = delete;
+    Table(Table &&o) noexcept : s(std::move(o.s)) {}
+    Table &operator=(Table &&o) noexcept
+    {
+	if(this != &o) {
+	    close();
+	    s = std::move(o.s);
+	}
+	return *this;
+    }
+    ~Table() { close(); }
+
+    /**
+     * Open existing DB. Fails with LDB_ERR_HEADER if its item size isn't sizeof(T)
+     */
+    LDB_RES open(const char *path_index, const char *path_data)
+    {
+	close();
+	init();
+	LDB_RES r = ldb_open(&s->db, const_cast<char*>(path_index),
+			     const_cast<char*>(path_data));
+	if(r != LDB_OK) {
+	    s.reset();
+	    return r;
+	}
+	if(s->db.h.item_size != sizeof(T)) {
+	    close();
+	    return LDB_ERR_HEADER;
+	}
+	return set_buffer();
+    }
+#if !LDB_READ_ONLY
+    /**
+     * Create new DB of items T. header can be empty
+     */
+    LDB_RES create(const char *path_index, const char *path_data,
+		   std::span<const uint8_t> header = {}, uint32_t flags = 0)
+    {
+	close();
+	init();
+	LDB_RES r = ldb_create_ex(&s->db, const_cast<char*>(path_index),
+				  const_cast<char*>(path_data), sizeof(T),
+				  header.size(),
+				  const_cast<uint8_t*>(header.data()), flags);
+	if(r != LDB_OK) {
+	    s.reset();
+	    return r;
+	}
+	return set_buffer();
+    }
+#endif
+    LDB_RES close()
+    {
+	if(!s)
+	    return LDB_OK;
+	LDB_RES r = ldb_close(&s->db);
+	s.reset();
+	return r;
+    }
+
+    bool is_open() const { return s != nullptr; }
+    //underlying DB for functions which aren't wrapped
+    LighDB *db() { return s ? &s->db : nullptr; }
+    uint32_t count() const { return s ? s->db.h.count : 0; }
+
+    LDB_RES get(uint32_t id, T &item)
+    {
+	return ldb_get(db(), id, reinterpret_cast<uint8_t*>(&item), sizeof(T));
+    }
+    LDB_RES get_ind(uint32_t index, T &item)
+    {
+	return ldb_get_ind(db(), index,
+			   reinterpret_cast<uint8_t*>(&item), sizeof(T));
+    }
+    /**
+     * Get items.size() items one by one starting from index
+     */
+    LDB_RES get_range(uint32_t index, std::span<T> items)
+    {
+	return ldb_get_range(db(), index, items.size(),
+			     reinterpret_cast<uint8_t*>(items.data()),
+			     items.size_bytes());
+    }
+    /**
+     * Find indexes of items with ID. count returns count of found indexes
+     */
+    LDB_RES find(uint32_t id, std::span<uint32_t> indexes, uint32_t &count)
+    {
+	count = 0;
+	return ldb_find_by_id(db(), id, &count,
+			      indexes.data(), indexes.size());
+    }
+#if !LDB_READ_ONLY
+    LDB_RES upd(uint32_t id, const T &item)
+    {
+	return ldb_upd(db(), id, const_cast<T*>(&item), sizeof(T));
+    }
+    LDB_RES upd_ind(uint32_t index, const T &item)
+    {
+	return ldb_upd_ind(db(), index, const_cast<T*>(&item), sizeof(T));
+    }
+    LDB_RES add(uint32_t id, const T &item, uint32_t *newindex = nullptr)
+    {
+	uint32_t i;
+	return ldb_add(db(), const_cast<T*>(&item), sizeof(T), id,
+		       newindex ? newindex : &i);
+    }
+    /**
+     * Add items with IDs ids by ldb_add() one by one, so every item takes mutex
+     * and writes ID table. Stops at first error, added items stay.
+     * Returns LDB_ERR_SIZE if ids and items have different sizes
+     */
+    LDB_RES add(std::span<const uint32_t> ids, std::span<const T> items)
+    {
+	if(ids.size() != items.size())
+	    return LDB_ERR_SIZE;
+	for (std::size_t i = 0; i < items.size(); i++)
+	    if(LDB_RES r = add(ids[i], items[i]); r != LDB_OK)
+		return r;
+	return LDB_OK;
+    }
+#endif
+    /**
+     * Scan all items with ldb_scan(). fn(index, item) returns true to stop scan.
+     * Called with mutex taken, so don't use this table inside
+     */
+    template <typename F>
+    LDB_RES scan(F &&fn, LDB_PRED *pred = nullptr)
+    {
+	return ldb_scan(db(), pred,
+			[](uint32_t index, uint8_t *item, uint32_t,
+			   void *arg) -> uint8_t {
+			    alignas(T) Storage t;
+			    std::memcpy(t, item, sizeof(T));
+			    using Fn = std::remove_reference_t<F>;
+			    return (*static_cast<Fn*>(arg))(
+				index, *std::launder(reinterpret_cast<T*>(t))) ? 1 : 0;
+			},
+			&fn);
+    }
+
+    /**
+     * Input iterator over all items. Items are read by ldb_get_range()
+     * in batches of Batch items. Iteration stops at first error
+     */
+    template <std::size_t Batch = 16>
+    class Iterator {
+	Table *t = nullptr;
+	uint32_t index = 0, first = 0, n = 0;
+	alignas(T) Storage items[Batch];
+
+	T *item(uint32_t i)
+	{
+	    return std::launder(reinterpret_cast<T*>(items[i]));
+	}
+	const T *item(uint32_t i) const
+	{
+	    return std::launder(reinterpret_cast<const T*>(items[i]));
+	}
+	void load()
+	{
+	    uint32_t left = t->count() - index;
+	    n = left < Batch ? left : Batch;
+	    first = index;
+	    if(n == 0 || t->get_range(index, std::span<T>(item(0), n)) != LDB_OK)
+		t = nullptr;
+	}
+    public:
+	using iterator_category = std::input_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const T*;
+	using reference = const T&;
+
+	Iterator() = default;
+	explicit Iterator(Table *table) : t(table) { load(); }
+
+	const T &operator*() const { return *item(index - first); }
+	const T *operator->() const { return item(index - first); }
+	//index of current item
+	uint32_t ind() const { return index; }
+	Iterator &operator++()
+	{
+	    if(++index - first >= n)
+		load();
+	    return *this;
+	}
+	void operator++(int) { ++*this; }
+	bool operator==(std::default_sentinel_t) const { return t == nullptr; }
+    };
+
+    Iterator<> begin() { return s ? Iterator<>(this) : Iterator<>(); }
+    std::default_sentinel_t end() const { return {}; }
+};
+
+} // namespace lighdb
+
+#endif